@@ -0,0 +1,344 @@
+#include <stdint.h>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "md_types.h"
+#include "md_order_book.h"
+
+/**
+ * Microbenchmarks of the order book on its own, no adapter, tokenizer,
+ * parser or publisher so only the cost of the book data structure is
+ * measured.
+ *
+ * Each benchmark is run for every book data structure and for a range
+ * of book shapes, the depth is the number of price levels each side and
+ * orders is the number of orders resting at each level. The book is
+ * built with bids below and asks above a mid price so nothing crosses
+ * and no trade is expected.
+ *
+ *   make book_bench
+ *   ./book_bench --benchmark_filter='BookVector>/depth:20'
+ *
+ */
+
+namespace {
+
+// Bids are below and asks above this price
+constexpr PriceLevelKey mid_price=1000;
+// Quantity of the resting orders
+constexpr QuantityValueType rest_quantity=10;
+// Orders added or cancelled before the book is put back as it was
+constexpr std::size_t batch_size=1024;
+// Operations in the mixed stream before the book is rebuilt
+constexpr std::size_t mix_size=1<<16;
+
+/**
+ * @brief The shape of a book and the orders that make it up
+ *
+ */
+class BookShape {
+public:
+	explicit BookShape(const benchmark::State& state) :
+		depth(state.range(0)),
+		orders_per_level(state.range(1)),
+		random(42) {
+		for (int level=1; level <= depth; level++) {
+			for (int i=0; i < orders_per_level; i++) {
+				resting.push_back({next_id++,Side::Bid,rest_quantity,mid_price-level});
+				resting.push_back({next_id++,Side::Ask,rest_quantity,mid_price+level});
+			}
+		}
+	}
+
+	/**
+	 * Add the resting orders to the book
+	 * @param book
+	 */
+	template <typename Book>
+	void fill(Book & book) const {
+		for (auto & order : resting) {
+			book.add(Order(order));
+		}
+	}
+
+	/**
+	 * New orders at random prices inside the book, not yet in it
+	 * @param count number of orders
+	 */
+	Orders new_orders(std::size_t count) {
+		Orders orders;
+		for (std::size_t i=0; i < count; i++) {
+			orders.push_back(random_order(next_id++));
+		}
+		return orders;
+	}
+
+	/**
+	 * A random order at a level inside the book either side
+	 * @param orderid of the order
+	 */
+	Order random_order(OrderIdKeyType orderid) {
+		PriceLevelKey level=std::uniform_int_distribution<int>(1,depth)(random);
+		if (random() & 1) {
+			return {orderid,Side::Bid,rest_quantity,mid_price-level};
+		}
+		return {orderid,Side::Ask,rest_quantity,mid_price+level};
+	}
+
+	// Price levels each side
+	int depth;
+	// Orders at each level
+	int orders_per_level;
+	// The orders of the book once filled
+	Orders resting;
+	// Next order id to give out, id 0 is not valid
+	OrderIdKeyType next_id=1;
+	// Fixed seed so each run is the same
+	std::mt19937 random;
+};
+
+/**
+ * @brief An operation of the mixed stream
+ *
+ */
+struct Operation {
+	Event event;
+	Order order;
+};
+
+template <typename BookContainer>
+void BM_Add(benchmark::State& state) {
+	BookShape shape(state);
+	OrderBook<BookContainer> book;
+	shape.fill(book);
+	Orders orders=shape.new_orders(batch_size);
+
+	std::size_t i=0;
+	for (auto _ : state) {
+		book.add(Order(orders[i]));
+		if (++i==orders.size()) {
+			// Take them out again so the book keeps its shape
+			state.PauseTiming();
+			for (auto & order : orders) {
+				book.cancel(Order(order));
+			}
+			i=0;
+			state.ResumeTiming();
+		}
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+template <typename BookContainer>
+void BM_Cancel(benchmark::State& state) {
+	BookShape shape(state);
+	OrderBook<BookContainer> book;
+	shape.fill(book);
+	Orders orders=shape.new_orders(batch_size);
+
+	std::size_t i=0;
+	for (auto _ : state) {
+		if (i==0) {
+			// Put back the orders to cancel
+			state.PauseTiming();
+			for (auto & order : orders) {
+				book.add(Order(order));
+			}
+			state.ResumeTiming();
+		}
+		book.cancel(Order(orders[i]));
+		if (++i==orders.size()) {
+			i=0;
+		}
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+template <typename BookContainer>
+void BM_Modify(benchmark::State& state) {
+	BookShape shape(state);
+	OrderBook<BookContainer> book;
+	shape.fill(book);
+
+	// Every resting order up and then back down, in a random order
+	Orders orders=shape.resting;
+	std::shuffle(orders.begin(),orders.end(),shape.random);
+	std::size_t count=orders.size();
+	for (std::size_t i=0; i < count; i++) {
+		Order down=orders[i];
+		orders[i].quantity=2*rest_quantity;
+		orders.push_back(down);
+	}
+
+	std::size_t i=0;
+	for (auto _ : state) {
+		book.modify(Order(orders[i]));
+		if (++i==orders.size()) {
+			i=0;
+		}
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+template <typename BookContainer>
+void BM_Trade(benchmark::State& state) {
+	BookShape shape(state);
+	OrderBook<BookContainer> book;
+	shape.fill(book);
+
+	// A few trades at each price before it moves on
+	uint32_t i=0;
+	for (auto _ : state) {
+		PriceLevelKey level=1+(i++ >> 2) % shape.depth;
+		book.trade(Trade{Side::Ask,rest_quantity,mid_price+level});
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+template <typename BookContainer>
+void BM_TopOfBook(benchmark::State& state) {
+	BookShape shape(state);
+	OrderBook<BookContainer> book;
+	shape.fill(book);
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(book.get_top_bid());
+		benchmark::DoNotOptimize(book.get_top_ask());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+template <typename BookContainer, int n>
+void BM_BookData(benchmark::State& state) {
+	BookShape shape(state);
+	OrderBook<BookContainer> book;
+	shape.fill(book);
+
+	for (auto _ : state) {
+		auto data=book.template book_data<n>();
+		benchmark::DoNotOptimize(data);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+template <typename BookContainer>
+void BM_MidData(benchmark::State& state) {
+	BookShape shape(state);
+	OrderBook<BookContainer> book;
+	shape.fill(book);
+
+	for (auto _ : state) {
+		auto data=book.template mid_data<5>();
+		benchmark::DoNotOptimize(data);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * Stream of operations as a feed would give them, 35% add, 25% modify,
+ * 35% cancel and 5% trade of the orders live at the time, so the book
+ * keeps roughly its shape
+ */
+std::vector<Operation> mixed_operations(BookShape & shape) {
+	std::vector<Operation> operations;
+	Orders live=shape.resting;
+	std::uniform_int_distribution<int> percent(0,99);
+	while (operations.size() < mix_size) {
+		int choice=percent(shape.random);
+		if (choice < 35 || live.empty()) {
+			Order order=shape.random_order(shape.next_id++);
+			live.push_back(order);
+			operations.push_back({Event::Add,order});
+		}
+		else if (choice < 95) {
+			std::size_t i=std::uniform_int_distribution<std::size_t>(0,live.size()-1)(shape.random);
+			if (choice < 60) {
+				live[i].quantity=live[i].quantity==rest_quantity ? 2*rest_quantity : rest_quantity;
+				operations.push_back({Event::Modify,live[i]});
+			}
+			else {
+				operations.push_back({Event::Cancel,live[i]});
+				live[i]=live.back();
+				live.pop_back();
+			}
+		}
+		else {
+			operations.push_back({Event::Trade,shape.random_order(0)});
+		}
+	}
+	return operations;
+}
+
+template <typename BookContainer>
+void BM_Mix(benchmark::State& state) {
+	BookShape shape(state);
+	std::vector<Operation> operations=mixed_operations(shape);
+	auto book=std::make_unique<OrderBook<BookContainer>>();
+	shape.fill(*book);
+
+	std::size_t i=0;
+	for (auto _ : state) {
+		const Operation & operation=operations[i];
+		switch (operation.event) {
+		case Event::Add:
+			book->add(Order(operation.order));
+			break;
+		case Event::Modify:
+			book->modify(Order(operation.order));
+			break;
+		case Event::Cancel:
+			book->cancel(Order(operation.order));
+			break;
+		default:
+			book->trade(Trade{operation.order.side,operation.order.quantity,operation.order.price});
+			break;
+		}
+		if (++i==operations.size()) {
+			// Start again from the same book
+			state.PauseTiming();
+			book=std::make_unique<OrderBook<BookContainer>>();
+			shape.fill(*book);
+			i=0;
+			state.ResumeTiming();
+		}
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * The book shapes each benchmark is run for
+ */
+void book_shapes(benchmark::internal::Benchmark* b) {
+	b->ArgNames({"depth","orders"});
+	for (int depth : {5,20,100}) {
+		for (int orders : {1,8}) {
+			b->Args({depth,orders});
+		}
+	}
+}
+
+}
+
+#define BOOK_BENCHMARKS(BookContainer) \
+	BENCHMARK_TEMPLATE(BM_Add,BookContainer)->Apply(book_shapes); \
+	BENCHMARK_TEMPLATE(BM_Cancel,BookContainer)->Apply(book_shapes); \
+	BENCHMARK_TEMPLATE(BM_Modify,BookContainer)->Apply(book_shapes); \
+	BENCHMARK_TEMPLATE(BM_Trade,BookContainer)->Apply(book_shapes); \
+	BENCHMARK_TEMPLATE(BM_TopOfBook,BookContainer)->Apply(book_shapes); \
+	BENCHMARK_TEMPLATE(BM_BookData,BookContainer,5)->Apply(book_shapes); \
+	BENCHMARK_TEMPLATE(BM_BookData,BookContainer,20)->Apply(book_shapes); \
+	BENCHMARK_TEMPLATE(BM_MidData,BookContainer)->Apply(book_shapes); \
+	BENCHMARK_TEMPLATE(BM_Mix,BookContainer)->Apply(book_shapes)
+
+BOOK_BENCHMARKS(BookMap);
+BOOK_BENCHMARKS(BookHash);
+BOOK_BENCHMARKS(BookVector);
+BOOK_BENCHMARKS(BookVectorInline);
+BOOK_BENCHMARKS(BookVectorSorted);
+BOOK_BENCHMARKS(BookLadder);
+
+BENCHMARK_MAIN();
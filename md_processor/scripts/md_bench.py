@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+
+import csv
+import gzip
+import itertools
+import json
+import os
+import re
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+
+'''
+    Run md_processor over every valid combination of adapter, tokenizer, book and
+    publisher against the bundled data and write one result per combination.
+
+    python3 md_bench.py --binary ../Release/md_processor --data ../data --repeat 5 > bench.csv
+    python3 md_bench.py --binary ../Release/md_processor --format json -d V -d L
+
+    Each combination is timed --repeat times and the median is reported, then run
+    once more with --latency for the percentiles. Output of the processor goes to
+    /dev/null so printing is included but not the terminal.
+
+    Columns are adapter, tokenizer, book, publisher, file, messages, msgs_per_sec,
+    ns_per_msg, ns_min, ns_max, p50, p90, p99, p99_9, max, peak_rss_kb
+'''
+
+ADAPTERS = ['F', 'M']
+BOOKS = ['M', 'H', 'V', 'I', 'S', 'L']
+PUBLISHERS = ['P', 'D', 'N']
+# Tokenizer and the data file it reads
+TOKENIZERS = [('A', 'md-test-2.json'), ('S', 'md-test-2.csv'), ('C', 'md-test-2.csv'), ('B', 'md-test-2.bin')]
+
+TIME_RE = re.compile(r'Time to process (\d+) messages => ([0-9.e+]+) micros')
+# The row of all messages from the merged histograms of the events
+LATENCY_RE = re.compile(r'^All\s+(\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+(\d+)')
+
+
+def prepare_data(data_dir, work_dir):
+    '''Unzip the bundled data if needed and make the binary file with md2bin'''
+    files = {}
+    for name in ('md-test-2.csv', 'md-test-2.json'):
+        path = os.path.join(data_dir, name)
+        if not os.path.exists(path):
+            path = os.path.join(work_dir, name)
+            with gzip.open(os.path.join(data_dir, name + '.gz'), 'rb') as src, open(path, 'wb') as dst:
+                shutil.copyfileobj(src, dst)
+        files[name] = path
+    path = os.path.join(work_dir, 'md-test-2.bin')
+    with open(files['md-test-2.csv'], 'rb') as src, open(path, 'wb') as dst:
+        subprocess.check_call([os.path.join(data_dir, 'md2bin')], stdin=src, stdout=dst)
+    files['md-test-2.bin'] = path
+    return files
+
+
+def run(binary, args):
+    '''Run once, return stderr and the peak resident set of the run in KB'''
+    with open(os.devnull, 'wb') as devnull:
+        process = subprocess.Popen([binary] + args, stdout=devnull, stderr=subprocess.PIPE)
+        err = process.stderr.read().decode(errors='replace')
+        _, status, usage = os.wait4(process.pid, 0)
+        process.returncode = os.waitstatus_to_exitcode(status)
+    if process.returncode != 0:
+        raise RuntimeError('%s %s failed with %d' % (binary, ' '.join(args), process.returncode))
+    return err, usage.ru_maxrss
+
+
+def latency(err):
+    '''Percentiles of all messages, the All row of the latency summary'''
+    for m in map(LATENCY_RE.match, err.splitlines()):
+        if m:
+            return dict(zip(('p50', 'p90', 'p99', 'p99_9', 'max'), (int(v) for v in m.groups()[1:])))
+    return {}
+
+
+def bench(binary, adapter, tokenizer, book, publisher, path, repeat):
+    args = ['--f=' + path, '--a=' + adapter, '--t=' + tokenizer, '--d=' + book,
+            '--s=' + publisher, '--p=C', '--x=L']
+    nanos = []
+    messages = 0
+    peak = 0
+    for _ in range(repeat):
+        err, rss = run(binary, args)
+        m = TIME_RE.search(err)
+        if not m:
+            raise RuntimeError('No timing from %s' % ' '.join(args))
+        messages = int(m.group(1))
+        nanos.append(float(m.group(2)) * 1000 / messages)
+        peak = max(peak, rss)
+    err, rss = run(binary, args + ['--latency'])
+    ns = statistics.median(nanos)
+    result = {
+        'adapter': adapter, 'tokenizer': tokenizer, 'book': book, 'publisher': publisher,
+        'file': os.path.basename(path), 'messages': messages,
+        'msgs_per_sec': round(1e9 / ns), 'ns_per_msg': round(ns, 1),
+        'ns_min': round(min(nanos), 1), 'ns_max': round(max(nanos), 1),
+        'p50': '', 'p90': '', 'p99': '', 'p99_9': '', 'max': '',
+        'peak_rss_kb': max(peak, rss),
+    }
+    result.update(latency(err))
+    return result
+
+
+if __name__ == '__main__':
+    from optparse import OptionParser
+    parser = OptionParser()
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser.add_option("-b", "--binary", action="store", type="string", dest="binary",
+                      default=os.path.join(here, '..', 'Release', 'md_processor'))
+    parser.add_option("--data", action="store", type="string", dest="data", default=os.path.join(here, '..', 'data'))
+    parser.add_option("-r", "--repeat", action="store", type="int", dest="repeat", default=5)
+    parser.add_option("--format", action="store", type="choice", choices=['csv', 'json'], dest="format", default='csv')
+    parser.add_option("-a", "--adapter", action="append", dest="adapters")
+    parser.add_option("-t", "--tokenizer", action="append", dest="tokenizers")
+    parser.add_option("-d", "--book", action="append", dest="books")
+    parser.add_option("-s", "--publisher", action="append", dest="publishers")
+
+    (options, args) = parser.parse_args()
+
+    tokenizers = [t for t in TOKENIZERS if not options.tokenizers or t[0] in options.tokenizers]
+    combinations = itertools.product(options.adapters or ADAPTERS, tokenizers,
+                                     options.books or BOOKS, options.publishers or PUBLISHERS)
+
+    work_dir = tempfile.mkdtemp(prefix='md_bench')
+    try:
+        files = prepare_data(options.data, work_dir)
+        writer = None
+        for adapter, (tokenizer, name), book, publisher in combinations:
+            result = bench(options.binary, adapter, tokenizer, book, publisher, files[name], options.repeat)
+            if options.format == 'json':
+                print(json.dumps(result))
+            else:
+                if writer is None:
+                    writer = csv.DictWriter(sys.stdout, fieldnames=list(result.keys()))
+                    writer.writeheader()
+                writer.writerow(result)
+            sys.stdout.flush()
+    finally:
+        shutil.rmtree(work_dir)
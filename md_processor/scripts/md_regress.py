@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+
+import difflib
+import glob
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+'''
+    Run md_processor over each case in data/regress with every book and compare
+    what it prints with the expected output of the case.
+
+    python3 md_regress.py --binary ../Release/md_processor --data ../data/regress
+    python3 md_regress.py -d V -d L
+
+    A case is <name>.csv, read with the strtk tokenizer and printed as csv, and
+    <name>.expected which is the csv output followed by the error summary. The
+    timings are left out as they change from run to run. Every book has to give
+    the same output. Exits 1 if any case differs.
+
+    Each case is also read with the C tokenizer and, converted with md2bin, the
+    B tokenizer. Their reports show the message as it was read and may name the
+    error differently, so for them only the book data and the line numbers of
+    the rejected messages have to be the same.
+'''
+
+BOOKS = ['M', 'H', 'V', 'I', 'S', 'L']
+TOKENIZERS = ['S', 'C', 'B']
+
+REJECTED_RE = re.compile(r'^Caught exception: .* line number:(\d+)$')
+
+
+def published(output):
+    '''The book data and the line number of each rejected message'''
+    lines = []
+    for line in output.splitlines(True):
+        if line.startswith('Error summary'):
+            break
+        m = REJECTED_RE.match(line.rstrip('\n'))
+        lines.append('rejected line number:%s\n' % m.group(1) if m else line)
+    return ''.join(lines)
+
+
+def run(binary, path, tokenizer, book):
+    '''Output of one run, stdout then stderr without the timings'''
+    args = ['--f=' + path, '--p=C', '--t=' + tokenizer, '--x=L', '--s=P', '--d=' + book]
+    process = subprocess.run([binary] + args, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    if process.returncode != 0:
+        raise RuntimeError('%s %s failed with %d' % (binary, ' '.join(args), process.returncode))
+    err = [line for line in process.stderr.decode(errors='replace').splitlines(True)
+           if not line.startswith('Time ')]
+    return process.stdout.decode(errors='replace') + ''.join(err)
+
+
+if __name__ == '__main__':
+    from optparse import OptionParser
+    parser = OptionParser()
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser.add_option("-b", "--binary", action="store", type="string", dest="binary",
+                      default=os.path.join(here, '..', 'Release', 'md_processor'))
+    parser.add_option("--data", action="store", type="string", dest="data",
+                      default=os.path.join(here, '..', 'data', 'regress'))
+    parser.add_option("-d", "--book", action="append", dest="books")
+    parser.add_option("-t", "--tokenizer", action="append", dest="tokenizers")
+
+    (options, args) = parser.parse_args()
+
+    failed = 0
+    work_dir = tempfile.mkdtemp(prefix='md_regress')
+    try:
+        for path in sorted(glob.glob(os.path.join(options.data, '*.csv'))):
+            name = os.path.splitext(os.path.basename(path))[0]
+            with open(os.path.splitext(path)[0] + '.expected') as f:
+                expected = f.read()
+            files = {'S': path, 'C': path, 'B': os.path.join(work_dir, name + '.bin')}
+            with open(path, 'rb') as src, open(files['B'], 'wb') as dst:
+                subprocess.check_call([os.path.join(here, '..', 'data', 'md2bin')], stdin=src, stdout=dst)
+            for tokenizer in options.tokenizers or TOKENIZERS:
+                for book in options.books or BOOKS:
+                    output = run(options.binary, files[tokenizer], tokenizer, book)
+                    want = expected
+                    if tokenizer != 'S':
+                        want, output = published(expected), published(output)
+                    if output == want:
+                        print('ok     %s -t %s -d %s' % (name, tokenizer, book))
+                        continue
+                    failed += 1
+                    print('FAILED %s -t %s -d %s' % (name, tokenizer, book))
+                    sys.stdout.writelines(difflib.unified_diff(want.splitlines(True), output.splitlines(True),
+                                                               'expected', '-t %s -d %s' % (tokenizer, book)))
+    finally:
+        shutil.rmtree(work_dir)
+    sys.exit(1 if failed else 0)
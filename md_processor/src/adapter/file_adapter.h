@@ -18,7 +18,7 @@ class file_adapter : public md_adapter {
 public:
 
 	file_adapter(const char* fn) :
-		infile(fn, std::ios::in) {
+		infile(fn, std::ios::in | std::ios::binary) {
 	}
 
 	/**
@@ -35,22 +35,47 @@ public:
     void start(MD & md) {
     	stopped=false;
 
+    	if (batch_size > 1) {
+    		start_batch(md);
+    		return;
+    	}
+
     	std::string line;
 
-    	while(!stopped && std::getline(infile, line)) {
+    	while(!stopped && get_message<TokenContainer>(infile, line)) {
     		try
     		{
-    			md.process_message(get_tokens<TokenContainer>(line));
+    			md.template process_line<TokenContainer>(line, counter);
     		}
     		catch(std::exception const& e)
     		{
-    		    std::cerr << "Caught exception: " << e.what() << " for event(" << line << ") line number:" << counter << "\n";
+    		    report_message_error(e, line, counter);
     		}
     		counter++;
     	}
     }
 
 private:
+	/**
+	 * Read batch_size messages at a time and process them together
+	 *
+	 * @param md The market data handler we will send the data to
+	 */
+    void start_batch(MD & md) {
+    	std::vector<std::string> lines(batch_size);
+
+    	while(!stopped) {
+    		std::size_t n=0;
+    		while (n < batch_size && get_message<TokenContainer>(infile, lines[n])) {
+    			n++;
+    		}
+    		if (n == 0) {
+    			break;
+    		}
+    		process_batch<TokenContainer>(md, lines.data(), n);
+    	}
+    }
+
     std::ifstream infile;
 };
 
@@ -2,12 +2,14 @@
 #ifndef md_adapter_h
 #define md_adapter_h
 
+#include <iostream>
 #include <string>
 #include <tuple>
 #include <utility>
 
 
 #include "md_types.h"
+#include "md_error_log.h"
 #include "md_stats.h"
 #include "md_helper.h"
 
@@ -27,9 +29,35 @@ struct md_adapter {
     void set_counter(int c){
     	counter=c;
     }
+    void set_batch(std::size_t size, bool each){
+    	batch_size=size;
+    	publish_each=each;
+    }
+
+    /**
+     * Tokenize and process a batch of messages, reporting any that
+     * fail to the error log with their line number
+     *
+     * @param md The market data handler we will send the data to
+     * @param lines the messages of the batch
+     * @param n number of messages
+     */
+    template <typename TokenContainer, typename MD, typename Line>
+    void process_batch(MD & md, const Line* lines, std::size_t n) {
+    	md.template process_lines<TokenContainer>(lines, n, counter, publish_each,
+    		[&](std::size_t i, auto const& error) {
+    			report_message_error(error, lines[i], counter+i);
+    		});
+    	counter+=n;
+    }
+
     bool stopped=true;
     int counter=0;
     int32_t numMessages=0;
+    // Messages processed together, 0 or 1 is one at a time
+    std::size_t batch_size=0;
+    // In a batch publish after every message not just the last
+    bool publish_each=false;
 };
 
 #endif
@@ -3,6 +3,7 @@
 #define memorymapped_file_adapter_h
 
 #include <fcntl.h>
+#include <string_view>
 #include "mio/mio.hpp"
 #include "md_adapter.h"
 
@@ -17,18 +18,6 @@ template <
 	typename MD
 >
 class memorymapped_file_adapter : public md_adapter {
-private:
-	using mm = mio::mmap_source;
-	bool _mmgetline(mm::const_iterator & cit, mm::const_iterator & eit, std::string & line) {
-		mm::const_iterator lit = cit;
-		while (*lit++ != '\n' and lit != eit);
-		line.assign(cit,lit-1);
-		if (lit != eit) {
-			cit = lit;
-			return true;
-		}
-		return false;
-	}
 public:
 
 	memorymapped_file_adapter(const char* fn) {
@@ -57,25 +46,52 @@ public:
     void start(MD & md) {
     	stopped=false;
 
-    	std::string line;
-    	auto it = infile.begin();
-    	auto eit = infile.end();
+    	// Lines, or binary messages, are views of the mapped file, no copy is made
+    	message_scanner<TokenContainer> lines(infile.data(), infile.data() + infile.size());
+
+    	if (batch_size > 1) {
+    		start_batch(md, lines);
+    		return;
+    	}
+
+    	std::string_view line;
 
-    	while(not stopped && _mmgetline(it, eit, line)) {
+    	while(not stopped && lines.next(line)) {
     		try
     		{
 
-    			md.process_message(get_tokens<TokenContainer>(line));
+    			md.template process_line<TokenContainer>(line, counter);
     		}
     		catch(std::exception const& e)
     		{
-    		    std::cerr << "Caught exception: " << e.what() << " for event(" << line << ") line number:" << counter << "\n";
+    		    report_message_error(e, line, counter);
     		}
     		counter++;
     	}
     }
 
 private:
+	/**
+	 * Take batch_size messages at a time and process them together
+	 *
+	 * @param md The market data handler we will send the data to
+	 * @param lines the messages of the file
+	 */
+    void start_batch(MD & md, message_scanner<TokenContainer> & lines) {
+    	std::vector<std::string_view> batch(batch_size);
+
+    	while(not stopped) {
+    		std::size_t n=0;
+    		while (n < batch_size && lines.next(batch[n])) {
+    			n++;
+    		}
+    		if (n == 0) {
+    			break;
+    		}
+    		process_batch<TokenContainer>(md, batch.data(), n);
+    	}
+    }
+
     mio::mmap_source  infile;
 };
 
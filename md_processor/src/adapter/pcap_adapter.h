@@ -147,11 +147,9 @@ public:
 					std::string line(reinterpret_cast<const char*>(value), length);
 
 					try {
-						md.process_message(get_tokens<TokenContainer>(line));
+						md.template process_line<TokenContainer>(line, counter);
 					} catch (std::exception const& e) {
-						std::cerr << "Caught exception: " << e.what()
-								<< " for event(" << line << ") line number:"
-								<< counter << "\n";
+						report_message_error(e, line, counter);
 					}
 					counter++;
 				}
@@ -73,12 +73,12 @@ public:
     			// TODO this shouldn't be a string, but a byte stream (nasty cast here!!)
  			if (r) {
     				line=std::string(static_cast<char*>(update.data()), update.size());
-    				md.process_message(get_tokens<TokenContainer>(line));
+    				md.template process_line<TokenContainer>(line, counter);
 			}
     		}
     		catch(std::exception const& e)
     		{
-    		    std::cerr << "Caught exception: " << e.what() << " for event(" << line << ") line number:" << counter+1 << "\n";
+    		    report_message_error(e, line, counter+1);
     		}
     		counter++;
     		// Ack this message
@@ -155,12 +155,12 @@ public:
     			zmq::detail::recv_result_t r = m_subscriber.recv(update);
     			if (r) {
     				line=std::string(static_cast<char*>(update.data()), update.size());
-    				md.process_message(get_tokens<TokenContainer>(line));
+    				md.template process_line<TokenContainer>(line, counter);
     			}
     		}
     		catch(std::exception const& e)
     		{
-    		    std::cerr << "Caught exception: " << e.what() << " for event(" << line << ") line number:" << counter+1 << "\n";
+    		    report_message_error(e, line, counter+1);
     		}
     		counter++;
 
@@ -229,12 +229,12 @@ public:
     	        if (r) {
     	        	// TODO this shouldn't be a string, but a byte stream (nasty cast here!!)
     	        	line=std::string(static_cast<char*>(update.data()), update.size());
-    	        	md.process_message(get_tokens<TokenContainer>(line));
+    	        	md.template process_line<TokenContainer>(line, counter);
     	        }
     		}
     		catch(std::exception const& e)
     		{
-    		    std::cerr << "Caught exception: " << e.what() << " for event(" << line << ") line number:" << counter+1 << "\n";
+    		    report_message_error(e, line, counter+1);
     		}
     		counter++;
     	}
@@ -82,6 +82,14 @@ public:
 		return default_value;
 	}
 
+	/**
+	 * Set an option, or replace it, i.e for the arguments of one
+	 * of several threads
+	 */
+	void set_opt(const std::string &long_name, const std::string &value) {
+		_args[long_name] = value;
+	}
+
 private:
 	std::map<std::string, std::string> _args;
 };
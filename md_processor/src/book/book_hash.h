@@ -2,6 +2,7 @@
 #define book_hash_h
 
 #include "md_basic_types.h"
+#include "node_pool.h"
 
 /**
    *  @brief Implementation of the support structure to an order book.
@@ -19,10 +20,13 @@
    *  as below
    */
 struct BookHash {
-	// Order quantities mapped by order id key
-	typedef typename std::unordered_map<OrderIdKeyType,QuantityValueType> Orders;
+	// Order quantities mapped by order id key with their total, the nodes
+	// of orders and levels are recycled through the pool
+	typedef LevelOrders<std::unordered_map<OrderIdKeyType,QuantityValueType,std::hash<OrderIdKeyType>,
+			std::equal_to<OrderIdKeyType>,PoolAllocator<std::pair<const OrderIdKeyType,QuantityValueType>>>> Orders;
 	// Each price level Bid/Ask of orders associated with orders by price key
-	typedef typename std::unordered_map<PriceLevelKey,Orders> PriceLevels;
+	typedef typename std::unordered_map<PriceLevelKey,Orders,std::hash<PriceLevelKey>,
+			std::equal_to<PriceLevelKey>,PoolAllocator<std::pair<const PriceLevelKey,Orders>>> PriceLevels;
 	typedef PriceLevels AskPriceLevels;
 	typedef PriceLevels BidPriceLevels;
 
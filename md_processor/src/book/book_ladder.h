@@ -0,0 +1,322 @@
+#ifndef book_ladder_h
+#define book_ladder_h
+
+#include "md_basic_types.h"
+#include "book_vector.h"
+
+/**
+   *  @brief Implementation of the support structure to an order book.
+   *
+   *  Prices are bounded by max_order_price so rather than searching for a
+   *  price level we can index straight into a flat array of levels, one slot
+   *  for every possible price i.e slot = (price - base).
+   *
+   *  i.e bidLevels[price][orderid] <- quantity
+   *
+   *  Which slots are in use is kept in a bitmap alongside the levels and the
+   *  best price is maintained as levels come and go. So the top of the book
+   *  is a member read and when the best level disappears we only need to
+   *  scan the bitmap, 64 prices at a time, for the next one.
+   *
+   *  The orders at each price reuse the BookVector orders so we keep the
+   *  contiguous quantities and the vectorized sum.
+   *
+   *  Possible issue is the memory for every price whether used or not and
+   *  the range of prices has to be known up front
+   */
+struct BookLadder {
+	// Orders at a price level are the same as the BookVector
+	typedef BookVector::Orders Orders;
+
+	/**
+	   *  @brief Represent the price levels of one side of the book
+	   *
+	   *  The levels are preallocated for the full price range and a bitmap
+	   *  records which of them hold orders.
+	   *
+	   *  @tparam Compare GreaterComp for bids (best is highest) and LessComp
+	   *  for asks (best is lowest)
+	   */
+	template<typename Compare>
+	struct PriceLadder {
+		// Lowest price we can hold, price zero is used as no price
+		static constexpr PriceLevelKey base=1;
+		// Number of price slots in the ladder
+		static constexpr std::size_t depth=max_order_price-base+1;
+		// Number of 64 bit words in the occupied bitmap
+		static constexpr std::size_t words=(depth+63)/64;
+
+		// Orders for every price in the range
+		std::vector<Orders> levels=std::vector<Orders>(depth);
+		// Bit set for each slot that holds a price level
+		std::array<uint64_t,words> occupied{};
+		// Best price on this side or PriceLevelKey{} if there is none
+		PriceLevelKey best{};
+		// Number of price levels in use
+		std::size_t level_count{};
+
+		/**
+		 *  @brief  Enquire to see if any price levels exist
+		 *
+		 */
+		bool empty() const {
+			return level_count==0;
+		}
+
+		/**
+		 *  @brief  Enquire to see how many price levels
+		 *
+		 */
+		std::size_t size() const {
+			return level_count;
+		}
+
+		/**
+		 *  @brief  Find how many of a particular price exist (should be 1)
+		 *  @param  price the price level we are looking for
+		 *
+		 *  Just a test of the bit for the slot
+		 *
+		 */
+		std::size_t count(const PriceLevelKey& price) const {
+			return is_occupied(slot(price)) ? 1 : 0;
+		}
+
+		/**
+		 *  @brief  Remove a price level
+		 *  @param  price the price level is we want to remove
+		 *
+		 *  The orders are cleared but keep their memory for the next time
+		 *  the price is used. If this was the best price then search for
+		 *  the next best.
+		 *
+		 */
+		void erase(const PriceLevelKey& price) {
+			std::size_t s = slot(price);
+			if (is_occupied(s)) {
+				occupied[s>>6] &= ~(uint64_t(1) << (s&63));
+				levels[s].clear();
+				--level_count;
+				if (price==best) {
+					best=next(price);
+				}
+			}
+		}
+
+		/**
+		 *  @brief  operator to get or create the price level
+		 *  @param  price key for the orders to get or create
+		 *  @return The modifiable reference to the
+		 *          orders for the price
+		 *
+		 *  Creating a level may give us a new best price
+		 *
+		 */
+		Orders&
+		operator[](const PriceLevelKey& price)
+		{
+			std::size_t s = slot(price);
+			if (!is_occupied(s)) {
+				occupied[s>>6] |= (uint64_t(1) << (s&63));
+				++level_count;
+				if (best==PriceLevelKey{} || Compare()(price,best)) {
+					best=price;
+				}
+			}
+			return levels[s];
+		}
+
+		/**
+		 *  @brief  Next price level behind the given price
+		 *  @param  price to search from
+		 *  @return next worse price or PriceLevelKey{} if there is none
+		 *
+		 *  For bids this is the next lower price and for asks the next
+		 *  higher one
+		 *
+		 */
+		PriceLevelKey next(const PriceLevelKey& price) const {
+			return next_slot(slot(price),Compare());
+		}
+
+		/**
+		 *  @brief  Clear the price levels
+		 *
+		 *  Only the levels in use need clearing
+		 *
+		 */
+		void clear() {
+			for (PriceLevelKey price=best; price!=PriceLevelKey{}; price=next(price)) {
+				levels[slot(price)].clear();
+			}
+			occupied.fill(0);
+			best=PriceLevelKey{};
+			level_count=0;
+		}
+
+	private:
+		/**
+		 *  @brief  Slot in the ladder for the price
+		 *
+		 */
+		static std::size_t slot(const PriceLevelKey& price) {
+			assert(price>=base && price<=max_order_price);
+			return price-base;
+		}
+
+		bool is_occupied(std::size_t s) const {
+			return (occupied[s>>6] >> (s&63)) & 1;
+		}
+
+		/**
+		 *  @brief  Bid search down the bitmap for the next lower price
+		 *
+		 */
+		PriceLevelKey next_slot(std::size_t s, GreaterComp) const {
+			if (s==0) {
+				return PriceLevelKey{};
+			}
+			std::size_t from = s-1;
+			std::size_t w = from>>6;
+			uint64_t mask = occupied[w] & (~uint64_t(0) >> (63-(from&63)));
+			while (true) {
+				if (mask) {
+					return (w<<6)+63-__builtin_clzll(mask)+base;
+				}
+				if (w==0) {
+					return PriceLevelKey{};
+				}
+				mask = occupied[--w];
+			}
+		}
+
+		/**
+		 *  @brief  Ask search up the bitmap for the next higher price
+		 *
+		 */
+		PriceLevelKey next_slot(std::size_t s, LessComp) const {
+			std::size_t from = s+1;
+			if (from>=depth) {
+				return PriceLevelKey{};
+			}
+			std::size_t w = from>>6;
+			uint64_t mask = occupied[w] & (~uint64_t(0) << (from&63));
+			while (true) {
+				if (mask) {
+					return (w<<6)+__builtin_ctzll(mask)+base;
+				}
+				if (++w==words) {
+					return PriceLevelKey{};
+				}
+				mask = occupied[w];
+			}
+		}
+	};
+
+	typedef PriceLadder<GreaterComp> BidPriceLevels;
+	typedef PriceLadder<LessComp> AskPriceLevels;
+
+	/**
+	 *  @brief  Get the top bid
+	 *  @return top bid price
+	 *
+	 *  Maintained as the levels change so nothing to search
+	 *
+	 */
+	PriceLevelKey get_top_bid() {
+		return bidLevels.best;
+	}
+
+	/**
+	 *  @brief  Get the top ask
+	 *  @return top ask price
+	 *
+	 *  Maintained as the levels change so nothing to search
+	 *
+	 */
+	PriceLevelKey get_top_ask() {
+		return askLevels.best;
+	}
+
+	typedef std::map<PriceLevelKey,BookLadder::Orders,GreaterComp> SortedBids;
+	typedef std::map<PriceLevelKey,BookLadder::Orders,LessComp> SortedAsks;
+
+	SortedBids & get_sorted_bids();
+	SortedAsks & get_sorted_asks();
+
+	void clear() {
+		bidLevels.clear();
+		askLevels.clear();
+	}
+
+	// Bid levels as a ladder indexed by price
+	BidPriceLevels bidLevels;
+	// Ask levels as a ladder indexed by price
+	AskPriceLevels askLevels;
+
+private:
+	// Bid levels copied in price order
+	SortedBids sortedBidLevels;
+	// Ask levels copied in price order
+	SortedAsks sortedAskLevels;
+};
+
+/**
+ *  @brief  Sort bid levels
+ *  @param  book BookContainer of with price levels
+ *
+ *  This is the specialized version of the sorting for BookLadder explicitly.
+ *
+ *  The ladder is already in price order so we walk down from the best bid
+ *
+ */
+template<>
+inline void sorted_bid(BookLadder & book,BookLadder::SortedBids & ordered) {
+	for (PriceLevelKey price=book.bidLevels.best; price!=PriceLevelKey{}; price=book.bidLevels.next(price)) {
+		ordered[price]=book.bidLevels[price];
+	}
+}
+
+/**
+ *  @brief  Sort ask levels
+ *  @param  book BookContainer of with price levels
+ *
+ *  This is the specialized version of the sorting for BookLadder explicitly.
+ *
+ *  The ladder is already in price order so we walk up from the best ask
+ *
+ */
+template<>
+inline void sorted_ask(BookLadder & book,BookLadder::SortedAsks & ordered) {
+	for (PriceLevelKey price=book.askLevels.best; price!=PriceLevelKey{}; price=book.askLevels.next(price)) {
+		ordered[price]=book.askLevels[price];
+	}
+}
+
+/**
+ *  @brief   Next price level behind a price
+ *  @param   levels the price levels of one side
+ *  @param   price to search from, PriceLevelKey{} for the best price
+ *  @param   comp GreaterComp for bids and LessComp for asks
+ *  @return  the next worse price
+ *
+ *  Search the ladder bitmap
+ */
+template<typename Compare>
+inline PriceLevelKey next_level(BookLadder::PriceLadder<Compare> & levels,const PriceLevelKey& price,Compare comp) {
+	return price==PriceLevelKey{} ? levels.best : levels.next(price);
+}
+
+inline BookLadder::SortedBids & BookLadder::get_sorted_bids() {
+	sortedBidLevels.clear();
+	sorted_bid(*this,sortedBidLevels);
+	return sortedBidLevels;
+}
+
+inline BookLadder::SortedAsks & BookLadder::get_sorted_asks() {
+	sortedAskLevels.clear();
+	sorted_ask(*this,sortedAskLevels);
+	return sortedAskLevels;
+}
+
+#endif
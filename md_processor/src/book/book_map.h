@@ -2,6 +2,7 @@
 #define book_map_h
 
 #include "md_basic_types.h"
+#include "node_pool.h"
 
 /**
    *  @brief Implementation of the support structure to an order book.
@@ -15,13 +16,20 @@
    *
    *  Possible issue is we are doing sorting that is not required for
    *  each add and erase and also we sum the quantities sequentially
+   *
+   *  Every order and level is a node, these come from @see PoolAllocator
+   *  so add and cancel reuse nodes rather than malloc and free them
    */
 struct BookMap {
-	// Order quantities mapped by order id key
-	typedef typename std::map<OrderIdKeyType,QuantityValueType> Orders;
+	// Order quantities mapped by order id key with their total, the nodes
+	// of orders and levels are recycled through the pool
+	typedef LevelOrders<std::map<OrderIdKeyType,QuantityValueType,std::less<OrderIdKeyType>,
+			PoolAllocator<std::pair<const OrderIdKeyType,QuantityValueType>>>> Orders;
 	// Each price level Bid/Ask of orders associated with orders by price key
-	typedef typename std::map<PriceLevelKey,Orders,GreaterComp> BidPriceLevels;
-	typedef typename std::map<PriceLevelKey,Orders,LessComp> AskPriceLevels;
+	typedef typename std::map<PriceLevelKey,Orders,GreaterComp,
+			PoolAllocator<std::pair<const PriceLevelKey,Orders>>> BidPriceLevels;
+	typedef typename std::map<PriceLevelKey,Orders,LessComp,
+			PoolAllocator<std::pair<const PriceLevelKey,Orders>>> AskPriceLevels;
 	typedef BidPriceLevels SortedBids;
 	typedef AskPriceLevels SortedAsks;
 
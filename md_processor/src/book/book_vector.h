@@ -2,295 +2,431 @@
 #define book_vector_h
 
 #include "md_basic_types.h"
+#include "order_index.h"
+#include "inline_orders.h"
+#include "sorted_price_levels.h"
 
 #include <functional>
+#include <type_traits>
 #include "vectorclass.h"
 #include "vectormath_exp.h"
 
 /**
-   *  @brief Implementation of the support structure to an order book.
+   *  @brief Represent the orders that can be added at a price level
    *
-   *  Using std::vector we can keep price levels indexed by another vector
-   *  which holds the prices an the index of this vector corresponds
-   *  exactly to the index of the orders price. the vector of orders are
-   *  indexed again bid another vector of order ids an the index of these
-   *  correspond exactly to the index of the quantity of the orderid.
+   *  Uses 2 vectors. One to hold the key of order ids and the other
+   *  the quantity. The position of the key is the same as the position
+   *  of the quantity.
    *
-   *  std::pair is also possible but wanted to be different from maps
-   *  as much as possible.
+   *  Note std::pair could have been used to do the mapping too
+   *  i.e std::vector<std::pair<OrderIdKeyType,QuantityValueType>> order_index;
+   *  But this is just an experiment
    *
-   *  std::vector<std::pair<OrderIdKeyType,QuantityValueType>> order_index;
+   *  Removing an order leaves a hole (order id 0 and quantity 0) so the
+   *  positions of the other orders, as held in the OrderIndex, do not move
+   *  and the sum is not affected. When the holes outnumber the orders the
+   *  level is compacted and the moved positions reported back.
    *
-   *  Also we could use the underlying vector as a basis to make_heap
-   *  in the PriceLevels struct an either maintain a sort or just sort
-   *  on demand certainly could maintain head of price levels this
-   *  would require the idea of std::pair to be in place also.
-   *
-   *  Advantages is that it is sorted and holds all the data in a contiguous
-   *  memory chunk. This mean we can take advantage of vector instructions
-   *  to do sum on columns much easier than that of the maps
+   *  The total quantity is kept as orders are pushed, set and erased so
+   *  the sum of the level is a read of it.
    *
-   * It requires more code around to implement the methods of the maps
-   * which are need by the order book such as the [] operator look up and
-   * maintenance of the vector
    */
-struct BookVector {
+struct VectorOrders {
+	// Order quantities mapped by following order id key vector
+	std::vector<QuantityValueType> orders;
+	// Order id keys
+	std::vector<OrderIdKeyType> order_index;
+	// Number of orders not counting the holes
+	std::size_t live=0;
+	// Sum of the order quantities
+	QuantityValueType total=0;
 
 	/**
-	   *  @brief Represent the orders that can be added at a price level
-	   *
-	   *  Uses 2 vectors. One to hold the key of order ids and the other
-	   *  the quantity. The position of the key is the same as the position
-	   *  of the quantity.
-	   *
-	   *  Note std::pair could have been used to do the mapping too
-	   *  i.e std::vector<std::pair<OrderIdKeyType,QuantityValueType>> order_index;
-	   *  But this is just an experiment
-	   *
-	   */
-	typedef struct {
-		// Order quantities mapped by following order id key vector
-		std::vector<QuantityValueType> orders;
-		// Order id keys
-		std::vector<OrderIdKeyType> order_index;
-
-		/**
-		 *  @brief  Enquire to see if any orders exist
-		 *
-		 *  This looks at the orders_index to see if empty
-		 *
-		 */
-		auto empty() -> decltype(order_index.empty()) const {
-			return order_index.empty();
-		}
+	 *  @brief  Enquire to see if any orders exist
+	 *
+	 *  This looks at the live count to see if empty
+	 *
+	 */
+	bool empty() const {
+		return live==0;
+	}
 
-		/**
-		 *  @brief  Enquire to see how many orders
-		 *
-		 *  This looks at the orders_index get the size
-		 *
-		 */
-		auto size() -> decltype(order_index.size()) const {
-			return order_index.size();
-		}
+	/**
+	 *  @brief  Enquire to see how many orders
+	 *
+	 *  This is the live count, not counting the holes
+	 *
+	 */
+	std::size_t size() const {
+		return live;
+	}
 
-		/**
-		 *  @brief  Find how many of a particular order id exist
-		 *  @param  order id the order is we are looking for
-		 *
-		 *  Looks at the orders_index get the count
-		 *
-		 */
-		auto count(const OrderIdKeyType& orderid) -> decltype(std::count(std::begin(order_index), std::end(order_index), orderid)) {
-			return std::count(order_index.begin(), order_index.end(), orderid);
-		}
+	/**
+	 *  @brief  Find how many of a particular order id exist
+	 *  @param  order id the order is we are looking for
+	 *
+	 *  Looks at the orders_index get the count
+	 *
+	 */
+	auto count(const OrderIdKeyType& orderid) -> decltype(std::count(std::begin(order_index), std::end(order_index), orderid)) {
+		return std::count(order_index.begin(), order_index.end(), orderid);
+	}
 
-		/**
-		 *  @brief  Remove an order
-		 *  @param  order id the order is we want to remove
-		 *
-		 *  Removes the order id and corresponding quantity
-		 *
-		 */
-		void erase(const OrderIdKeyType& orderid) {
-			auto iter_indxpos = std::find(std::begin(order_index), std::end(order_index), orderid);
-
-			if (iter_indxpos != std::end(order_index)) {
-				orders.erase(std::begin(orders)+(iter_indxpos-std::begin(order_index)));
-				order_index.erase(iter_indxpos);
-				assert(order_index.size()==orders.size());
-			}
+	/**
+	 *  @brief  Remove an order
+	 *  @param  order id the order is we want to remove
+	 *
+	 *  Removes the order id and corresponding quantity
+	 *
+	 */
+	void erase(const OrderIdKeyType& orderid) {
+		auto iter_indxpos = std::find(std::begin(order_index), std::end(order_index), orderid);
+
+		if (iter_indxpos != std::end(order_index)) {
+			erase_at(iter_indxpos-std::begin(order_index));
 		}
+	}
 
-		/**
-		 *  @brief  operator to get or create the order id
-		 *  		and quantity element in the vector
-		 *  @param  order id the order access
-		 *  @return The modifiable reference to the
-		 *          quantity for the order id
-		 *
-		 */
-		QuantityValueType&
-	    operator[](const OrderIdKeyType& orderid)
-	    {
-			auto iter_pos = std::find(std::begin(order_index), std::end(order_index), orderid);
-			if (iter_pos != std::end(order_index)) {
-				return orders[iter_pos-std::begin(order_index)];
-			}
-			else {
-				order_index.push_back(orderid);
-				orders.emplace_back(QuantityValueType{});
-				assert(order_index.size()==orders.size());
-				return orders.back();
-			}
-	    }
-
-		/**
-		 *  @brief  operator to get the order quantity
-		 *  		element in the vector
-		 *  @param  orderid the order access key
-		 *  @return The read only reference to the quantity
-		 *
-		 */
-		const QuantityValueType&
-	    operator[](const OrderIdKeyType& orderid) const
-	    {
-			auto iter_pos = std::find(std::begin(order_index), std::end(order_index), orderid);
-			if (iter_pos != std::end(order_index)) {
-				return orders[iter_pos-std::begin(order_index)];
-			}
-			else {
-				throw std::out_of_range("Order id:"+orderid);
-			}
-	    }
-
-		/**
-		 *  @brief  Clear the underlying orderbook data structure
-		 *
-		 *  This looks at the orders_index to see if empty
-		 *
-		 */
-		void clear() {
-			orders.clear();
-			order_index.clear();
+	/**
+	 *  @brief  Add an order to the back
+	 *  @param  orderid the new order id
+	 *  @param  quantity the new order quantity
+	 *  @return The position of the order
+	 *
+	 */
+	uint32_t push(const OrderIdKeyType& orderid,const QuantityValueType& quantity) {
+		order_index.push_back(orderid);
+		orders.push_back(quantity);
+		++live;
+		total+=quantity;
+		assert(order_index.size()==orders.size());
+		return order_index.size()-1;
+	}
+
+	/**
+	 *  @brief  Remove the order at a position
+	 *  @param  position of the order
+	 *
+	 *  Leaves a hole so no other order moves
+	 *
+	 */
+	void erase_at(std::size_t position) {
+		assert(order_index[position]!=OrderIdKeyType{});
+		total-=orders[position];
+		order_index[position]=OrderIdKeyType{};
+		orders[position]=QuantityValueType{};
+		if (--live==0) {
+			clear();
 		}
+	}
 
-	} Orders;
+	/**
+	 *  @brief  Change the quantity of the order at a position
+	 *  @param  position of the order
+	 *  @param  quantity the new quantity
+	 *
+	 */
+	void set(std::size_t position,const QuantityValueType& quantity) {
+		assert(order_index[position]!=OrderIdKeyType{});
+		total+=quantity-orders[position];
+		orders[position]=quantity;
+	}
 
 	/**
-	   *  @brief Represent the price level of the book
-	   *
-	   *  Uses 2 vectors. One to hold the key of price and the other
-	   *  the orders of Orders type as discussed above.
-	   *  The position of the key is the same as the position of the orders.
-	   *
-	   *  Note std::pair could have been used to do the mapping too
-	   *  i.e std::vector<std::pair<PriceLevelKey,Orders>> level_index;
-	   *  Also we could use heap functions to help sort get min/max element
-	   *  in constant time
-	   *
-	   *  But this is just an experiment and we could arrive back at std::map
-	   *  if we did!
-	   *
-	   */
-	typedef struct {
-		// Orders mapped by following price key vector
-		std::vector<Orders> levels;
-		std::vector<PriceLevelKey> level_index;
-
-		/**
-		 *  @brief  Enquire to see if any price levels exist
-		 *
-		 *  This looks at the level_index to see if empty
-		 *
-		 */
-		auto empty() -> decltype(level_index.empty()) const {
-			return level_index.empty();
+	 *  @brief  Do we have more holes than orders
+	 *
+	 */
+	bool fragmented() const {
+		return order_index.size()-live > live;
+	}
+
+	/**
+	 *  @brief  Remove the holes keeping the order of the orders
+	 *  @param  moved Callable (orderid, position) for each order that moves
+	 *
+	 */
+	template<typename Moved>
+	void compact(Moved moved) {
+		std::size_t to=0;
+		for (std::size_t from=0; from < order_index.size(); from++) {
+			if (order_index[from]!=OrderIdKeyType{}) {
+				if (to!=from) {
+					order_index[to]=order_index[from];
+					orders[to]=orders[from];
+					moved(order_index[to],to);
+				}
+				to++;
+			}
 		}
+		order_index.resize(to);
+		orders.resize(to);
+	}
 
-		/**
-		 *  @brief  Enquire to see how many price levels
-		 *
-		 *  This looks at the level_index get the size
-		 *
-		 */
-		auto size() -> decltype(level_index.size()) const {
-			return level_index.size();
+	/**
+	 *  @brief  operator to get or create the order id
+	 *  		and quantity element in the vector
+	 *  @param  order id the order access
+	 *  @return The modifiable reference to the
+	 *          quantity for the order id
+	 *
+	 *  Note changing the quantity through this reference is not
+	 *  seen by the total, use set
+	 *
+	 */
+	QuantityValueType&
+    operator[](const OrderIdKeyType& orderid)
+    {
+		auto iter_pos = std::find(std::begin(order_index), std::end(order_index), orderid);
+		if (iter_pos != std::end(order_index)) {
+			return orders[iter_pos-std::begin(order_index)];
+		}
+		else {
+			push(orderid,QuantityValueType{});
+			return orders.back();
 		}
+    }
 
-		/**
-		 *  @brief  Find how many of a particular price exist (should be 1)
-		 *  @param  order id the order is we are looking for
-		 *
-		 *  Looks at the level_index get the count
-		 *
-		 */
-		auto count(const PriceLevelKey& price) -> decltype(std::count(std::begin(level_index), std::end(level_index), price)) {
-			return std::count(std::begin(level_index), std::end(level_index), price);
+	/**
+	 *  @brief  operator to get the order quantity
+	 *  		element in the vector
+	 *  @param  orderid the order access key
+	 *  @return The read only reference to the quantity
+	 *
+	 */
+	const QuantityValueType&
+    operator[](const OrderIdKeyType& orderid) const
+    {
+		auto iter_pos = std::find(std::begin(order_index), std::end(order_index), orderid);
+		if (iter_pos != std::end(order_index)) {
+			return orders[iter_pos-std::begin(order_index)];
+		}
+		else {
+			throw std::out_of_range("Order id:"+orderid);
 		}
+    }
+
+	/**
+	 *  @brief  Clear the underlying orderbook data structure
+	 *
+	 *  This looks at the orders_index to see if empty
+	 *
+	 */
+	void clear() {
+		orders.clear();
+		order_index.clear();
+		live=0;
+		total=0;
+	}
+
+};
+
+/**
+   *  @brief Represent the price level of the book
+   *
+   *  Uses 2 vectors. One to hold the key of price and the other
+   *  the orders of Orders type as discussed above.
+   *  The position of the key is the same as the position of the orders.
+   *
+   *  Note std::pair could have been used to do the mapping too
+   *  i.e std::vector<std::pair<PriceLevelKey,Orders>> level_index;
+   *  Also we could use heap functions to help sort get min/max element
+   *  in constant time
+   *
+   *  But this is just an experiment and we could arrive back at std::map
+   *  if we did!
+   *
+   *  The levels are in no order so room for reserved_levels is made up
+   *  front and a level is removed by moving the last level into its place,
+   *  the levels behind it do not shift and a book no deeper than that
+   *  never reallocates them. A deeper book grows the vectors as before.
+   *
+   *  @tparam Orders the orders at a price level
+   */
+template<typename Orders>
+struct VectorPriceLevels {
+	// Levels a side has room for before the vectors grow
+	static constexpr std::size_t reserved_levels=32;
+
+	// Orders mapped by following price key vector
+	std::vector<Orders> levels;
+	std::vector<PriceLevelKey> level_index;
+
+	VectorPriceLevels() {
+		levels.reserve(reserved_levels);
+		level_index.reserve(reserved_levels);
+	}
+
+	/**
+	 *  @brief  Enquire to see if any price levels exist
+	 *
+	 *  This looks at the level_index to see if empty
+	 *
+	 */
+	auto empty() -> decltype(level_index.empty()) const {
+		return level_index.empty();
+	}
+
+	/**
+	 *  @brief  Enquire to see how many price levels
+	 *
+	 *  This looks at the level_index get the size
+	 *
+	 */
+	auto size() -> decltype(level_index.size()) const {
+		return level_index.size();
+	}
+
+	/**
+	 *  @brief  Find how many of a particular price exist (should be 1)
+	 *  @param  order id the order is we are looking for
+	 *
+	 *  Looks at the level_index get the count
+	 *
+	 */
+	auto count(const PriceLevelKey& price) -> decltype(std::count(std::begin(level_index), std::end(level_index), price)) {
+		return std::count(std::begin(level_index), std::end(level_index), price);
+	}
 
-		/**
-		 *  @brief  Remove a price level
-		 *  @param  price the price level is we want to remove
-		 *
-		 *  Removes the price key and corresponding orders
-		 *
-		 */
-		void erase(const PriceLevelKey& price) {
-			auto iter_indxpos = std::find(std::begin(level_index), std::end(level_index), price);
-
-			if (iter_indxpos != std::end(level_index)) {
-				levels.erase(std::begin(levels)+(iter_indxpos-std::begin(level_index)));
-				level_index.erase(iter_indxpos);
-				// !!! Warning no transaction !!!
-				assert(level_index.size()==levels.size());
+	/**
+	 *  @brief  Remove a price level
+	 *  @param  price the price level is we want to remove
+	 *
+	 *  Removes the price key and corresponding orders, the last level
+	 *  moves into its place
+	 *
+	 */
+	void erase(const PriceLevelKey& price) {
+		auto iter_indxpos = std::find(std::begin(level_index), std::end(level_index), price);
+
+		if (iter_indxpos != std::end(level_index)) {
+			std::size_t position=iter_indxpos-std::begin(level_index);
+			if (position+1 != level_index.size()) {
+				levels[position]=std::move(levels.back());
+				level_index[position]=level_index.back();
 			}
+			levels.pop_back();
+			level_index.pop_back();
+			// !!! Warning no transaction !!!
+			assert(level_index.size()==levels.size());
 		}
+	}
 
-		/**
-		 *  @brief  operator to get or create the price key
-		 *  		and Orders element in the vector
-		 *  @param  price key for the orders to get or create
-		 *  @return The modifiable reference to the
-		 *          orders for the price
-		 *
-		 */
-		Orders&
-	    operator[](const PriceLevelKey& price)
-	    {
-			auto iter_pos = std::find(std::begin(level_index), std::end(level_index), price);
-			if (iter_pos != std::end(level_index)) {
-				return levels[iter_pos-std::begin(level_index)];
-			}
-			else {
-				level_index.push_back(price);
-				levels.emplace_back(Orders());
-				// !!! Warning no transaction !!!
-				assert(level_index.size()==levels.size());
-				return levels.back();
-			}
-	    }
-
-		/**
-		 *  @brief  operator to get the orders
-		 *  		element in the vector
-		 *  @param  price key for orders
-		 *  @return The read only reference to the orders
-		 *
-		 */
-		const Orders&
-	    operator[](const PriceLevelKey& price) const
-	    {
-			auto iter_pos = std::find(std::begin(level_index), std::end(level_index), price);
-			if (iter_pos != std::end(level_index)) {
-				return levels[iter_pos-std::begin(level_index)];
-			}
-			else {
-				throw std::out_of_range("Price:"+price);
-			}
-	    }
-
-		/**
-		 *  @brief  Clear the underlying orderbook data structure
-		 *
-		 *  This looks at the orders_index to see if empty
-		 *
-		 */
-		void clear() {
-			levels.clear();
-			level_index.clear();
+	/**
+	 *  @brief  operator to get or create the price key
+	 *  		and Orders element in the vector
+	 *  @param  price key for the orders to get or create
+	 *  @return The modifiable reference to the
+	 *          orders for the price
+	 *
+	 */
+	Orders&
+    operator[](const PriceLevelKey& price)
+    {
+		auto iter_pos = std::find(std::begin(level_index), std::end(level_index), price);
+		if (iter_pos != std::end(level_index)) {
+			return levels[iter_pos-std::begin(level_index)];
 		}
+		else {
+			level_index.push_back(price);
+			levels.emplace_back(Orders());
+			// !!! Warning no transaction !!!
+			assert(level_index.size()==levels.size());
+			return levels.back();
+		}
+    }
+
+	/**
+	 *  @brief  operator to get the orders
+	 *  		element in the vector
+	 *  @param  price key for orders
+	 *  @return The read only reference to the orders
+	 *
+	 */
+	const Orders&
+    operator[](const PriceLevelKey& price) const
+    {
+		auto iter_pos = std::find(std::begin(level_index), std::end(level_index), price);
+		if (iter_pos != std::end(level_index)) {
+			return levels[iter_pos-std::begin(level_index)];
+		}
+		else {
+			throw std::out_of_range("Price:"+price);
+		}
+    }
+
+	/**
+	 *  @brief  Clear the underlying orderbook data structure
+	 *
+	 *  This looks at the orders_index to see if empty
+	 *
+	 */
+	void clear() {
+		levels.clear();
+		level_index.clear();
+	}
+
+};
 
-	} PriceLevels;
+/**
+   *  @brief Implementation of the support structure to an order book.
+   *
+   *  Using std::vector we can keep price levels indexed by another vector
+   *  which holds the prices an the index of this vector corresponds
+   *  exactly to the index of the orders price. the vector of orders are
+   *  indexed again bid another vector of order ids an the index of these
+   *  correspond exactly to the index of the quantity of the orderid.
+   *
+   *  std::pair is also possible but wanted to be different from maps
+   *  as much as possible.
+   *
+   *  std::vector<std::pair<OrderIdKeyType,QuantityValueType>> order_index;
+   *
+   *  Also we could use the underlying vector as a basis to make_heap
+   *  in the PriceLevels struct an either maintain a sort or just sort
+   *  on demand certainly could maintain head of price levels this
+   *  would require the idea of std::pair to be in place also.
+   *
+   *  Advantages is that it is sorted and holds all the data in a contiguous
+   *  memory chunk. This mean we can take advantage of vector instructions
+   *  to do sum on columns much easier than that of the maps
+   *
+   * It requires more code around to implement the methods of the maps
+   * which are need by the order book such as the [] operator look up and
+   * maintenance of the vector
+   *
+   * The orders at a price level are a template parameter, BookVector keeps
+   * them in the VectorOrders and BookVectorInline in the InlineOrders which
+   * hold the first orders of a level in place. The levels themselves are
+   * moved, not shifted, when one is removed, and are reserved up front so a
+   * book no deeper than @see VectorPriceLevels::reserved_levels does not
+   * reallocate them.
+   *
+   * With Sorted the level index of each side is kept in price order, best
+   * first, as the @see SortedPriceLevels so the top of the book is the
+   * first price and the levels behind it are found by a search rather
+   * than looking at every price.
+   *
+   * @tparam OrdersType the orders at a price level
+   * @tparam Sorted keep the price levels in price order
+   */
+template<typename OrdersType, bool Sorted=false>
+struct BasicBookVector {
+	// The orders at a price level
+	typedef OrdersType Orders;
+	// The price levels of a side when not sorted
+	typedef VectorPriceLevels<Orders> PriceLevels;
 
 	/**
 	 *  @brief  Get the top bid
 	 *  @return top bid price
 	 *
-	 *  get the top by using a max search
+	 *  get the top by using a max search, or the first price if sorted
 	 *
 	 */
 	PriceLevelKey get_top_bid() {
+		if constexpr (Sorted) {
+			return bidLevels.best();
+		}
 		auto iter_pos = std::max_element(bidLevels.level_index.begin(),
 						bidLevels.level_index.end());
 		if (iter_pos != std::end(bidLevels.level_index)) {
@@ -305,10 +441,13 @@ struct BookVector {
 	 *  @brief  Get the top bid
 	 *  @return top ask price
 	 *
-	 *  get the top by using a min search
+	 *  get the top by using a min search, or the first price if sorted
 	 *
 	 */
 	PriceLevelKey get_top_ask() {
+		if constexpr (Sorted) {
+			return askLevels.best();
+		}
 		auto iter_pos = std::min_element(askLevels.level_index.begin(),
 				askLevels.level_index.end());
 		if (iter_pos != std::end(askLevels.level_index)) {
@@ -319,11 +458,11 @@ struct BookVector {
 		}
 	}
 
-	typedef PriceLevels AskPriceLevels;
-	typedef PriceLevels BidPriceLevels;
+	typedef typename std::conditional<Sorted,SortedPriceLevels<Orders,LessComp>,PriceLevels>::type AskPriceLevels;
+	typedef typename std::conditional<Sorted,SortedPriceLevels<Orders,GreaterComp>,PriceLevels>::type BidPriceLevels;
 
-	typedef std::map<PriceLevelKey,BookVector::Orders,GreaterComp> SortedBids;
-	typedef std::map<PriceLevelKey,BookVector::Orders,LessComp> SortedAsks;
+	typedef std::map<PriceLevelKey,Orders,GreaterComp> SortedBids;
+	typedef std::map<PriceLevelKey,Orders,LessComp> SortedAsks;
 
 	SortedBids & get_sorted_bids();
 	SortedAsks & get_sorted_asks();
@@ -342,6 +481,12 @@ private:
 	SortedAsks sortedAskLevels;
 };
 
+// The orders at a price level in two std::vectors
+typedef BasicBookVector<VectorOrders> BookVector;
+// The orders at a price level held in place, without FIFO priority
+typedef BasicBookVector<InlineOrders<>> BookVectorInline;
+// The orders at a price level in two std::vectors with the levels in price order
+typedef BasicBookVector<VectorOrders,true> BookVectorSorted;
 
 /**
  *  @brief  Sort bid levels
@@ -351,13 +496,19 @@ private:
  *
  *  We return the sorted map by simply adding the values out of the BookVector
  *
- *  So not efficient but it needs to be analysed in use case.
+ *  So not efficient but it needs to be analysed in use case. When the
+ *  levels are sorted they go in at the end of the map without a search.
  *
  */
-template<>
-inline void sorted_bid(BookVector & book,BookVector::SortedBids & ordered) {
+template<typename Orders, bool Sorted>
+inline void sorted_bid(BasicBookVector<Orders,Sorted> & book,typename BasicBookVector<Orders,Sorted>::SortedBids & ordered) {
 	for (decltype(book.bidLevels.levels.size()) i=0; i< book.bidLevels.levels.size(); i++) {
-		ordered[book.bidLevels.level_index[i]]=book.bidLevels.levels[i];
+		if constexpr (Sorted) {
+			ordered.emplace_hint(ordered.end(),book.bidLevels.level_index[i],book.bidLevels.levels[i]);
+		}
+		else {
+			ordered[book.bidLevels.level_index[i]]=book.bidLevels.levels[i];
+		}
 	}
 }
 
@@ -370,29 +521,59 @@ inline void sorted_bid(BookVector & book,BookVector::SortedBids & ordered) {
  *
  *  We return the sorted map by simply adding the values out of the BookVector
  *
- *  So not efficient but it needs to be analysed in use case.
+ *  So not efficient but it needs to be analysed in use case. When the
+ *  levels are sorted they go in at the end of the map without a search.
  *
  */
-template<>
-inline void sorted_ask(BookVector & book,BookVector::SortedAsks & ordered) {
+template<typename Orders, bool Sorted>
+inline void sorted_ask(BasicBookVector<Orders,Sorted> & book,typename BasicBookVector<Orders,Sorted>::SortedAsks & ordered) {
 	for (decltype(book.askLevels.levels.size()) i=0; i< book.askLevels.levels.size(); i++) {
-		ordered[book.askLevels.level_index[i]]=book.askLevels.levels[i];
+		if constexpr (Sorted) {
+			ordered.emplace_hint(ordered.end(),book.askLevels.level_index[i],book.askLevels.levels[i]);
+		}
+		else {
+			ordered[book.askLevels.level_index[i]]=book.askLevels.levels[i];
+		}
+	}
+}
+
+/**
+ *  @brief   Next price level behind a price
+ *  @param   levels the price levels of one side
+ *  @param   price to search from, PriceLevelKey{} for the best price
+ *  @param   comp GreaterComp for bids and LessComp for asks
+ *  @return  the next worse price
+ *
+ *  The level index is not sorted so look at every price
+ */
+template<typename Orders, typename Compare>
+inline PriceLevelKey next_level(VectorPriceLevels<Orders> & levels,const PriceLevelKey& price,Compare comp) {
+	PriceLevelKey next{};
+	for (auto level_price : levels.level_index) {
+		if ((price==PriceLevelKey{} || comp(price,level_price)) &&
+			(next==PriceLevelKey{} || comp(level_price,next))) {
+			next=level_price;
+		}
 	}
+	return next;
 }
 
-inline BookVector::SortedBids & BookVector::get_sorted_bids() {
+template<typename OrdersType, bool Sorted>
+inline typename BasicBookVector<OrdersType,Sorted>::SortedBids & BasicBookVector<OrdersType,Sorted>::get_sorted_bids() {
 	sortedBidLevels.clear();
 	sorted_bid(*this,sortedBidLevels);
 	return sortedBidLevels;
 }
 
-inline BookVector::SortedAsks & BookVector::get_sorted_asks() {
+template<typename OrdersType, bool Sorted>
+inline typename BasicBookVector<OrdersType,Sorted>::SortedAsks & BasicBookVector<OrdersType,Sorted>::get_sorted_asks() {
 	sortedAskLevels.clear();
 	sorted_ask(*this,sortedAskLevels);
 	return sortedAskLevels;
 }
 
-void BookVector::clear() {
+template<typename OrdersType, bool Sorted>
+inline void BasicBookVector<OrdersType,Sorted>::clear() {
 	bidLevels.clear();
 	askLevels.clear();
 }
@@ -430,14 +611,14 @@ template<> struct VecType<uint16_t>
 
 /**
  *  @brief  Vectorize the sum od quantities
- *  @param  vector of quantities
+ *  @param  data contiguous quantities
+ *  @param  size number of quantities
  *
  *  Using VCL as included in vectorclass sub dir
  *
  */
-QuantityValueType vector_sum(std::vector<QuantityValueType> vec) {
-	const int datasize = vec.size();
-	decltype(vec.data()) data = vec.data();
+inline QuantityValueType vector_sum(const QuantityValueType* data,std::size_t size) {
+	const int datasize = size;
 
 	typedef VecType<QuantityValueType>  VecT;
 	const int regularpart = datasize & (-VecT::size);
@@ -457,21 +638,167 @@ QuantityValueType vector_sum(std::vector<QuantityValueType> vec) {
 	// i.e if 13 elements and VecT::size is 8 then we
 	// add the remaining 5 here
 	for (; i < datasize; i++) {
-		sum += vec.data()[i];
+		sum += data[i];
 	}
 
 	return sum;
 }
 
 /**
- *  @brief  Specialized sum calling the vector_sum function
+ *  @brief  Vectorize the sum od quantities
+ *  @param  vector of quantities
+ *
+ */
+inline QuantityValueType vector_sum(const std::vector<QuantityValueType> & vec) {
+	return vector_sum(vec.data(),vec.size());
+}
+
+/**
+ *  @brief  Add an order to a price level
+ *  @param  orders the orders at the price level
+ *  @param  orderid the new order
+ *  @param  quantity of the new order
+ *  @return position of the order in the level
+ *
+ *  The position is kept in the OrderIndex so we don't search the level again
+ *
+ */
+inline uint32_t insert_order(VectorOrders & orders,const OrderIdKeyType& orderid,const QuantityValueType& quantity) {
+	return orders.push(orderid,quantity);
+}
+
+/**
+ *  @brief  Get the quantity of an order in a price level
+ *  @param  orders the orders at the price level
+ *  @param  location of the order from the OrderIndex
+ *  @return the quantity
+ *
+ */
+inline QuantityValueType order_quantity(VectorOrders & orders,const OrderLocation& location) {
+	assert(orders.order_index[location.position]==location.orderid);
+	return orders.orders[location.position];
+}
+
+/**
+ *  @brief  Change the quantity of an order in a price level
+ *  @param  orders the orders at the price level
+ *  @param  location of the order from the OrderIndex
+ *  @param  quantity the new quantity
+ *
+ */
+inline void change_quantity(VectorOrders & orders,const OrderLocation& location,const QuantityValueType& quantity) {
+	assert(orders.order_index[location.position]==location.orderid);
+	orders.set(location.position,quantity);
+}
+
+/**
+ *  @brief  Remove an order from a price level
+ *  @tparam Moved Callable (orderid, position) for orders whose position changes
+ *  @param  orders the orders at the price level
+ *  @param  location of the order from the OrderIndex
+ *
+ *  Compacts the level when there are too many holes
+ *
+ */
+template<typename Moved>
+inline void erase_order(VectorOrders & orders,const OrderLocation& location,Moved moved) {
+	orders.erase_at(location.position);
+	if (orders.fragmented()) {
+		orders.compact(moved);
+	}
+}
+
+/**
+ *  @brief  Specialized sum reading the running total
  *  @param  vector of orders for a price level
  *  @return the sum of quantities
  *
+ *  If __VERIFY_LEVEL_SUM__ is defined then the total is checked
+ *  against the vector_sum of the quantities
+ *
  */
 template<>
-auto sum(BookVector::Orders & orders) -> QuantityValueType {
-	return vector_sum(orders.orders);
+inline auto sum(VectorOrders & orders) -> QuantityValueType {
+#ifdef __VERIFY_LEVEL_SUM__
+	if (orders.total!=vector_sum(orders.orders)) {
+		throw std::runtime_error("Level total does not match the orders");
+	}
+#endif
+	return orders.total;
+}
+
+/**
+ *  @brief  Add an order to a price level held in place
+ *  @param  orders the orders at the price level
+ *  @param  orderid the new order
+ *  @param  quantity of the new order
+ *  @return position of the order in the level
+ *
+ */
+template<std::size_t Capacity, bool Fifo>
+inline uint32_t insert_order(InlineOrders<Capacity,Fifo> & orders,const OrderIdKeyType& orderid,const QuantityValueType& quantity) {
+	return orders.push(orderid,quantity);
+}
+
+/**
+ *  @brief  Get the quantity of an order in a price level held in place
+ *  @param  orders the orders at the price level
+ *  @param  location of the order from the OrderIndex
+ *  @return the quantity
+ *
+ */
+template<std::size_t Capacity, bool Fifo>
+inline QuantityValueType order_quantity(InlineOrders<Capacity,Fifo> & orders,const OrderLocation& location) {
+	assert(orders.orderid(location.position)==location.orderid);
+	return orders.quantity(location.position);
+}
+
+/**
+ *  @brief  Change the quantity of an order in a price level held in place
+ *  @param  orders the orders at the price level
+ *  @param  location of the order from the OrderIndex
+ *  @param  quantity the new quantity
+ *
+ */
+template<std::size_t Capacity, bool Fifo>
+inline void change_quantity(InlineOrders<Capacity,Fifo> & orders,const OrderLocation& location,const QuantityValueType& quantity) {
+	assert(orders.orderid(location.position)==location.orderid);
+	orders.set(location.position,quantity);
+}
+
+/**
+ *  @brief  Remove an order from a price level held in place
+ *  @tparam Moved Callable (orderid, position) for orders whose position changes
+ *  @param  orders the orders at the price level
+ *  @param  location of the order from the OrderIndex
+ *
+ *  Without Fifo the last order takes its place, with Fifo the orders
+ *  behind it move up
+ *
+ */
+template<std::size_t Capacity, bool Fifo, typename Moved>
+inline void erase_order(InlineOrders<Capacity,Fifo> & orders,const OrderLocation& location,Moved moved) {
+	assert(orders.orderid(location.position)==location.orderid);
+	orders.erase_at(location.position,moved);
+}
+
+/**
+ *  @brief  Sum reading the running total of a price level held in place
+ *  @param  orders for a price level
+ *  @return the sum of quantities
+ *
+ *  If __VERIFY_LEVEL_SUM__ is defined then the total is checked
+ *  against the vector_sum of the quantities
+ *
+ */
+template<std::size_t Capacity, bool Fifo>
+inline auto sum(InlineOrders<Capacity,Fifo> & orders) -> QuantityValueType {
+#ifdef __VERIFY_LEVEL_SUM__
+	if (orders.total()!=vector_sum(orders.quantities(),orders.size())) {
+		throw std::runtime_error("Level total does not match the orders");
+	}
+#endif
+	return orders.total();
 }
 
 #endif
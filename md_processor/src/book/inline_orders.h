@@ -0,0 +1,329 @@
+#ifndef inline_orders_h
+#define inline_orders_h
+
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include "md_basic_types.h"
+#include "node_pool.h"
+
+/**
+   *  @brief Pool of the overflow blocks of @see InlineOrders by size.
+   *
+   *  A block holds the quantities of Orders orders followed by their ids.
+   *  Blocks double in size from the inline capacity so each size is a
+   *  NodePool of its own, beyond max_orders the levels are rare enough
+   *  to go to operator new.
+   *
+   *  @tparam Orders number of orders a block of this size holds
+   */
+template<std::size_t Orders>
+struct OrderBlockPool {
+	// Largest block that is pooled
+	static constexpr std::size_t max_orders=256;
+	// Bytes of a block with its quantities and order ids
+	static constexpr std::size_t bytes=Orders*(sizeof(QuantityValueType)+sizeof(OrderIdKeyType));
+
+	/**
+	 *  @brief  Take a block for a number of orders
+	 *  @param  orders the capacity, a power of 2 times the inline capacity
+	 *  @return the block
+	 */
+	static void* allocate(std::size_t orders) {
+		if constexpr (Orders > max_orders) {
+			return ::operator new(orders*(sizeof(QuantityValueType)+sizeof(OrderIdKeyType)));
+		}
+		else {
+			if (orders==Orders) {
+				return NodePool<bytes,alignof(std::max_align_t)>::allocate();
+			}
+			return OrderBlockPool<Orders*2>::allocate(orders);
+		}
+	}
+
+	/**
+	 *  @brief  Give back a block
+	 *  @param  block from @see allocate
+	 *  @param  orders the capacity it was allocated with
+	 */
+	static void deallocate(void* block,std::size_t orders) noexcept {
+		if constexpr (Orders > max_orders) {
+			::operator delete(block);
+		}
+		else {
+			if (orders==Orders) {
+				NodePool<bytes,alignof(std::max_align_t)>::deallocate(block);
+			}
+			else {
+				OrderBlockPool<Orders*2>::deallocate(block,orders);
+			}
+		}
+	}
+};
+
+/**
+   *  @brief The orders at a price level held in place, structure of arrays.
+   *
+   *  The quantities and order ids are two arrays side by side in the one
+   *  block, so the quantities stay contiguous for the vector_sum, and the
+   *  first Capacity orders are held inline in the level itself so most
+   *  levels never allocate at all. A level that outgrows its block moves
+   *  to one twice the size from the @see OrderBlockPool, the old block
+   *  goes back to the pool, so once a session has seen its deepest levels
+   *  adding and removing orders does no malloc or free.
+   *
+   *  Unlike the VectorOrders there are no holes. The book only publishes
+   *  the aggregate of a level so without Fifo an order is removed by moving
+   *  the last order into its place, a single order moves. With Fifo the
+   *  orders behind it shift down to keep their time priority. Either way
+   *  the orders moved are reported so the OrderIndex follows them.
+   *
+   *  The total quantity is kept as orders are pushed, set and erased so
+   *  the sum of the level is a read of it.
+   *
+   *  @tparam Capacity orders held inline, 8 quantities is one AVX2 vector
+   *  @tparam Fifo keep the orders in time priority when one is removed
+   */
+template<std::size_t Capacity=8, bool Fifo=false>
+class InlineOrders {
+public:
+	InlineOrders() = default;
+
+	InlineOrders(const InlineOrders& other) : count(other.count), level_total(other.level_total) {
+		if (other.overflow) {
+			capacity=other.capacity;
+			overflow=static_cast<QuantityValueType*>(OrderBlockPool<Capacity*2>::allocate(capacity));
+		}
+		std::memcpy(quantities(),other.quantities(),sizeof(QuantityValueType)*count);
+		std::memcpy(orderids(),other.orderids(),sizeof(OrderIdKeyType)*count);
+	}
+
+	InlineOrders(InlineOrders&& other) noexcept {
+		take(other);
+	}
+
+	InlineOrders& operator=(const InlineOrders& other) {
+		if (this!=&other) {
+			InlineOrders copy(other);
+			*this=std::move(copy);
+		}
+		return *this;
+	}
+
+	InlineOrders& operator=(InlineOrders&& other) noexcept {
+		if (this!=&other) {
+			release();
+			take(other);
+		}
+		return *this;
+	}
+
+	~InlineOrders() {
+		release();
+	}
+
+	/**
+	 *  @brief  Enquire to see if any orders exist
+	 *
+	 */
+	bool empty() const {
+		return count==0;
+	}
+
+	/**
+	 *  @brief  Enquire to see how many orders
+	 *
+	 */
+	std::size_t size() const {
+		return count;
+	}
+
+	/**
+	 *  @brief  Sum of the order quantities
+	 *
+	 */
+	QuantityValueType total() const {
+		return level_total;
+	}
+
+	/**
+	 *  @brief  The quantities of the orders, size() of them
+	 *
+	 */
+	const QuantityValueType* quantities() const {
+		return overflow ? overflow : inline_quantities;
+	}
+
+	/**
+	 *  @brief  The order ids, size() of them in the same order
+	 *
+	 */
+	const OrderIdKeyType* orderids() const {
+		return overflow ? reinterpret_cast<const OrderIdKeyType*>(overflow+capacity) : inline_orderids;
+	}
+
+	/**
+	 *  @brief  Add an order to the back
+	 *  @param  orderid the new order id
+	 *  @param  quantity the new order quantity
+	 *  @return The position of the order
+	 *
+	 */
+	uint32_t push(const OrderIdKeyType& orderid,const QuantityValueType& quantity) {
+		if (unlikely(count==capacity)) {
+			grow();
+		}
+		quantities()[count]=quantity;
+		orderids()[count]=orderid;
+		level_total+=quantity;
+		return count++;
+	}
+
+	/**
+	 *  @brief  Quantity of the order at a position
+	 *  @param  position of the order
+	 *
+	 */
+	QuantityValueType quantity(std::size_t position) const {
+		assert(position < count);
+		return quantities()[position];
+	}
+
+	/**
+	 *  @brief  Order id at a position
+	 *  @param  position of the order
+	 *
+	 */
+	OrderIdKeyType orderid(std::size_t position) const {
+		assert(position < count);
+		return orderids()[position];
+	}
+
+	/**
+	 *  @brief  Change the quantity of the order at a position
+	 *  @param  position of the order
+	 *  @param  quantity the new quantity
+	 *
+	 */
+	void set(std::size_t position,const QuantityValueType& quantity) {
+		assert(position < count);
+		level_total+=quantity-quantities()[position];
+		quantities()[position]=quantity;
+	}
+
+	/**
+	 *  @brief  Remove the order at a position
+	 *  @tparam Moved Callable (orderid, position) for each order that moves
+	 *  @param  position of the order
+	 *  @param  moved called for the orders that take a new position
+	 *
+	 */
+	template<typename Moved>
+	void erase_at(std::size_t position,Moved moved) {
+		assert(position < count);
+		QuantityValueType* q=quantities();
+		OrderIdKeyType* ids=orderids();
+		level_total-=q[position];
+		--count;
+		if constexpr (Fifo) {
+			std::memmove(q+position,q+position+1,sizeof(QuantityValueType)*(count-position));
+			std::memmove(ids+position,ids+position+1,sizeof(OrderIdKeyType)*(count-position));
+			for (std::size_t i=position; i < count; i++) {
+				moved(ids[i],i);
+			}
+		}
+		else {
+			if (position!=count) {
+				q[position]=q[count];
+				ids[position]=ids[count];
+				moved(ids[position],position);
+			}
+		}
+	}
+
+	/**
+	 *  @brief  Remove all the orders, an overflow block goes back to the pool
+	 *
+	 */
+	void clear() {
+		release();
+		count=0;
+		level_total=0;
+	}
+
+private:
+	QuantityValueType* quantities() {
+		return overflow ? overflow : inline_quantities;
+	}
+
+	OrderIdKeyType* orderids() {
+		return overflow ? reinterpret_cast<OrderIdKeyType*>(overflow+capacity) : inline_orderids;
+	}
+
+	/**
+	 *  @brief  Move the orders to a block twice the size
+	 *
+	 */
+	void grow() {
+		uint32_t grown=capacity*2;
+		auto block=static_cast<QuantityValueType*>(OrderBlockPool<Capacity*2>::allocate(grown));
+		std::memcpy(block,quantities(),sizeof(QuantityValueType)*count);
+		std::memcpy(block+grown,orderids(),sizeof(OrderIdKeyType)*count);
+		release();
+		overflow=block;
+		capacity=grown;
+	}
+
+	/**
+	 *  @brief  Give back the overflow block and go back to inline
+	 *
+	 */
+	void release() noexcept {
+		if (overflow) {
+			OrderBlockPool<Capacity*2>::deallocate(overflow,capacity);
+			overflow=nullptr;
+			capacity=Capacity;
+		}
+	}
+
+	/**
+	 *  @brief  Take the orders of another level leaving it empty
+	 *
+	 */
+	void take(InlineOrders& other) noexcept {
+		count=other.count;
+		level_total=other.level_total;
+		if (other.overflow) {
+			overflow=other.overflow;
+			capacity=other.capacity;
+			other.overflow=nullptr;
+			other.capacity=Capacity;
+		}
+		else {
+			std::memcpy(inline_quantities,other.inline_quantities,sizeof(QuantityValueType)*count);
+			std::memcpy(inline_orderids,other.inline_orderids,sizeof(OrderIdKeyType)*count);
+		}
+		other.count=0;
+		other.level_total=0;
+	}
+
+	static_assert(Capacity > 0 && (Capacity & (Capacity-1))==0,"Inline capacity must be a power of 2");
+	static_assert(alignof(OrderIdKeyType) <= alignof(QuantityValueType),"Order ids follow the quantities in a block");
+
+	// Number of orders
+	uint32_t count=0;
+	// Orders the current block holds, Capacity while inline
+	uint32_t capacity=Capacity;
+	// Sum of the order quantities
+	QuantityValueType level_total=0;
+	// Block from the pool once the orders outgrow the inline arrays,
+	// capacity quantities followed by capacity order ids
+	QuantityValueType* overflow=nullptr;
+	// Quantities of the first Capacity orders
+	QuantityValueType inline_quantities[Capacity];
+	// Order ids of the first Capacity orders
+	OrderIdKeyType inline_orderids[Capacity];
+};
+
+#endif
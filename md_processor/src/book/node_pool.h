@@ -0,0 +1,141 @@
+#ifndef node_pool_h
+#define node_pool_h
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+#include "md_helper.h"
+
+/**
+   *  @brief Free list of fixed size nodes for the node based containers.
+   *
+   *  The std::map and std::unordered_map of BookMap and BookHash allocate a
+   *  node for every order and every price level and free it again on cancel.
+   *  Here freed nodes go on a free list and are handed straight back out on
+   *  the next allocation so once a book has reached its working size the
+   *  churn of add and cancel does no malloc or free at all.
+   *
+   *  Nodes are carved out of slabs of slab_nodes at a time, so they sit
+   *  close together, and slabs are never given back. There is one free list
+   *  per node size and thread, each book is only ever changed from the one
+   *  thread (shards have their own books) so there is no locking. A node
+   *  freed on another thread, i.e when the books are destroyed, just joins
+   *  the free list of that thread.
+   *
+   *  @tparam Size of the node in bytes
+   *  @tparam Align alignment the node needs
+   */
+template<std::size_t Size, std::size_t Align>
+class NodePool {
+public:
+	/**
+	 *  @brief  Take a node off the free list
+	 *  @return storage for one node
+	 */
+	static void* allocate() {
+		Node*& head=free_list();
+		if (unlikely(head==nullptr)) {
+			grow(head);
+		}
+		Node* node=head;
+		head=node->next;
+		return node;
+	}
+
+	/**
+	 *  @brief  Put a node back on the free list
+	 *  @param  p node from @see allocate
+	 */
+	static void deallocate(void* p) noexcept {
+		Node*& head=free_list();
+		Node* node=static_cast<Node*>(p);
+		node->next=head;
+		head=node;
+	}
+
+private:
+	// Nodes allocated at a time
+	static constexpr std::size_t slab_nodes=1024;
+
+	/**
+	 *  @brief A free node holds the link to the next
+	 */
+	union Node {
+		Node* next;
+		alignas(Align) unsigned char storage[Size];
+	};
+
+	static_assert(Align <= alignof(std::max_align_t),"Node alignment is more than operator new gives");
+
+	/**
+	 *  @brief  The free list of this thread
+	 */
+	static Node*& free_list() noexcept {
+		static thread_local Node* head=nullptr;
+		return head;
+	}
+
+	/**
+	 *  @brief  Add a new slab of nodes to an empty free list
+	 *  @param  head of the free list
+	 */
+	static void grow(Node*& head) {
+		Node* slab=static_cast<Node*>(::operator new(sizeof(Node)*slab_nodes));
+		for (std::size_t i=0; i < slab_nodes-1; i++) {
+			slab[i].next=&slab[i+1];
+		}
+		slab[slab_nodes-1].next=nullptr;
+		head=slab;
+	}
+};
+
+/**
+   *  @brief Allocator for the std containers of the books which takes
+   *  single nodes from the @see NodePool.
+   *
+   *  Anything bigger than one element, such as the bucket array of an
+   *  unordered_map, is left to the standard allocator. The allocator has
+   *  no state so any two are equal and containers can swap or move their
+   *  nodes between them.
+   *
+   *  @tparam T type of the node
+   */
+template<typename T>
+struct PoolAllocator {
+	typedef T value_type;
+
+	PoolAllocator() noexcept = default;
+
+	template<typename U>
+	PoolAllocator(const PoolAllocator<U>&) noexcept {
+	}
+
+	T* allocate(std::size_t n) {
+		if (n==1) {
+			return static_cast<T*>(NodePool<sizeof(T),alignof(T)>::allocate());
+		}
+		return std::allocator<T>().allocate(n);
+	}
+
+	void deallocate(T* p, std::size_t n) noexcept {
+		if (n==1) {
+			NodePool<sizeof(T),alignof(T)>::deallocate(p);
+		}
+		else {
+			std::allocator<T>().deallocate(p,n);
+		}
+	}
+};
+
+template<typename T, typename U>
+inline bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept {
+	return true;
+}
+
+template<typename T, typename U>
+inline bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept {
+	return false;
+}
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef order_index_h
+#define order_index_h
+
+#include "md_basic_types.h"
+
+/**
+ *  @brief Where an order lives in the book
+ *
+ *  The side and price select the price level and the position is where the
+ *  order sits inside the level for containers that can use it. Node based
+ *  containers just look the order id up in the level.
+ *
+ */
+typedef struct {
+	OrderIdKeyType orderid;
+	PriceLevelKey price;
+	uint32_t position;
+	Side side;
+} OrderLocation;
+
+/**
+   *  @brief Index of every order in the book by order id, side and price.
+   *
+   *  Cancel and modify only give us the order id, side and price so without
+   *  this we would look up the level and then search it for the order. Here
+   *  we go straight to the order location.
+   *
+   *  An order is only ever a duplicate of an order in its own price level,
+   *  so the same order id can rest on the other side or at another price,
+   *  i.e the synthetic ids of snapshot orders share the range of the feed's
+   *  ids. The key is all three so the index finds the same orders the
+   *  levels would.
+   *
+   *  Order ids range up to max_order_id so a dense array is too big, instead
+   *  this is a flat open addressing table with linear probing. The table is
+   *  a power of 2 in size and is kept at most half full so probe sequences
+   *  stay short. Removal shifts the following entries back rather than
+   *  leaving tombstones so the table does not degrade with churn.
+   *
+   *  Order id 0 is never valid (range checked in the parser) so marks
+   *  an empty slot.
+   */
+class OrderIndex {
+public:
+	explicit OrderIndex(std::size_t capacity=1024) {
+		std::size_t size=1;
+		while (size < capacity) {
+			size<<=1;
+		}
+		slots.assign(size,OrderLocation{});
+		mask=size-1;
+	}
+
+	/**
+	 *  @brief  Find an order
+	 *  @param  orderid the order id to look for
+	 *  @param  side of the order
+	 *  @param  price of the order
+	 *  @return pointer to the location or nullptr if we don't have the order
+	 *
+	 */
+	OrderLocation* find(const OrderIdKeyType& orderid,Side side,PriceLevelKey price) {
+		for (std::size_t i=hash(orderid,side,price);; i=(i+1)&mask) {
+			OrderLocation & slot=slots[i];
+			if (matches(slot,orderid,side,price)) {
+				return &slot;
+			}
+			if (slot.orderid==OrderIdKeyType{}) {
+				return nullptr;
+			}
+		}
+	}
+
+	/**
+	 *  @brief  Add an order that is not already in the index
+	 *  @param  location of the new order
+	 *
+	 */
+	void insert(const OrderLocation& location) {
+		assert(location.orderid!=OrderIdKeyType{});
+		if ((count+1)*2 > slots.size()) {
+			grow();
+		}
+		place(location);
+		++count;
+	}
+
+	/**
+	 *  @brief  Remove an order
+	 *  @param  orderid the order to remove
+	 *  @param  side of the order
+	 *  @param  price of the order
+	 *
+	 *  Any entries in the probe sequence after the removed one that would
+	 *  no longer be found are moved back into the gap
+	 *
+	 */
+	void erase(const OrderIdKeyType& orderid,Side side,PriceLevelKey price) {
+		std::size_t i=hash(orderid,side,price);
+		while (not matches(slots[i],orderid,side,price)) {
+			if (slots[i].orderid==OrderIdKeyType{}) {
+				return;
+			}
+			i=(i+1)&mask;
+		}
+
+		std::size_t gap=i;
+		for (std::size_t j=(i+1)&mask; slots[j].orderid!=OrderIdKeyType{}; j=(j+1)&mask) {
+			std::size_t home=hash(slots[j]);
+			// Move back if the gap lies between the home slot and here
+			if (((j-home)&mask) >= ((j-gap)&mask)) {
+				slots[gap]=slots[j];
+				gap=j;
+			}
+		}
+		slots[gap]=OrderLocation{};
+		--count;
+	}
+
+	/**
+	 *  @brief  Number of orders in the index
+	 *
+	 */
+	std::size_t size() const {
+		return count;
+	}
+
+	/**
+	 *  @brief  Remove all the orders, keeping the table size
+	 *
+	 */
+	void clear() {
+		std::fill(slots.begin(),slots.end(),OrderLocation{});
+		count=0;
+	}
+
+private:
+	/**
+	 *  @brief  Fibonacci hash of the order key to a slot
+	 *
+	 *  Order ids are often sequential so multiply to spread them
+	 *  over the table, the price and side are folded into the top
+	 *  half so they do not collide with the id
+	 *
+	 */
+	std::size_t hash(const OrderIdKeyType& orderid,Side side,PriceLevelKey price) const {
+		uint64_t key=static_cast<uint64_t>(orderid)
+				^ (static_cast<uint64_t>(price) << 32)
+				^ (static_cast<uint64_t>(side) << 56);
+		return (key*0x9E3779B97F4A7C15ull >> 32) & mask;
+	}
+
+	std::size_t hash(const OrderLocation& location) const {
+		return hash(location.orderid,location.side,location.price);
+	}
+
+	static bool matches(const OrderLocation& slot,const OrderIdKeyType& orderid,Side side,PriceLevelKey price) {
+		return slot.orderid==orderid && slot.side==side && slot.price==price;
+	}
+
+	void place(const OrderLocation& location) {
+		std::size_t i=hash(location);
+		while (slots[i].orderid!=OrderIdKeyType{}) {
+			i=(i+1)&mask;
+		}
+		slots[i]=location;
+	}
+
+	/**
+	 *  @brief  Double the table and put the orders back
+	 *
+	 */
+	void grow() {
+		std::vector<OrderLocation> old(slots.size()*2,OrderLocation{});
+		old.swap(slots);
+		mask=slots.size()-1;
+		for (auto & location : old) {
+			if (location.orderid!=OrderIdKeyType{}) {
+				place(location);
+			}
+		}
+	}
+
+	// The open addressing table
+	std::vector<OrderLocation> slots;
+	// Table size - 1 to wrap the probing
+	std::size_t mask{};
+	// Number of orders held
+	std::size_t count{};
+};
+
+/**
+ *  @brief   Add an order to a price level
+ *  @tparam  Orders This is the BookContainers internal data structure for the orders
+ *  @param   orders the orders at the price level
+ *  @param   orderid the new order
+ *  @param   quantity of the new order
+ *  @return	 position of the order in the level
+ *
+ *  This is the default used by the map containers where the position is not
+ *  needed as the orders are keyed by order id
+ */
+template<typename Orders>
+inline uint32_t insert_order(Orders & orders,const OrderIdKeyType& orderid,const QuantityValueType& quantity) {
+	orders[orderid]=quantity;
+	orders.total+=quantity;
+	return 0;
+}
+
+/**
+ *  @brief   Get the quantity of an order in a price level
+ *  @tparam  Orders This is the BookContainers internal data structure for the orders
+ *  @param   orders the orders at the price level
+ *  @param   location of the order from the OrderIndex
+ *  @return	 the quantity
+ *
+ *  This is the default used by the map containers, look up by order id
+ */
+template<typename Orders>
+inline QuantityValueType order_quantity(Orders & orders,const OrderLocation& location) {
+	return orders[location.orderid];
+}
+
+/**
+ *  @brief   Change the quantity of an order in a price level
+ *  @tparam  Orders This is the BookContainers internal data structure for the orders
+ *  @param   orders the orders at the price level
+ *  @param   location of the order from the OrderIndex
+ *  @param   quantity the new quantity
+ *
+ *  This is the default used by the map containers, look up by order id
+ */
+template<typename Orders>
+inline void change_quantity(Orders & orders,const OrderLocation& location,const QuantityValueType& quantity) {
+	auto & current=orders[location.orderid];
+	orders.total+=quantity-current;
+	current=quantity;
+}
+
+/**
+ *  @brief   Remove an order from a price level
+ *  @tparam  Orders This is the BookContainers internal data structure for the orders
+ *  @tparam  Moved Callable (orderid, position) for orders whose position changes
+ *  @param   orders the orders at the price level
+ *  @param   location of the order from the OrderIndex
+ *
+ *  This is the default used by the map containers, positions never change
+ */
+template<typename Orders, typename Moved>
+inline void erase_order(Orders & orders,const OrderLocation& location,Moved moved) {
+	auto current=orders.find(location.orderid);
+	if (current!=orders.end()) {
+		orders.total-=current->second;
+		orders.erase(current);
+	}
+}
+
+#endif
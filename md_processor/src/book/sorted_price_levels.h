@@ -0,0 +1,235 @@
+#ifndef sorted_price_levels_h
+#define sorted_price_levels_h
+
+#include <string>
+#include <vector>
+
+#include "md_basic_types.h"
+#include "vectorclass.h"
+
+/**
+ *  @brief  Lanes of prices ahead of a price, best first
+ *  @param  prices 8 prices of the level index
+ *  @param  price the price looked for in every lane
+ *
+ *  Bids are highest first
+ */
+inline Vec8ib prices_ahead(const Vec8ui& prices,const Vec8ui& price,GreaterComp) {
+	return prices > price;
+}
+
+/**
+ *  @brief  Lanes of prices ahead of a price, best first
+ *  @param  prices 8 prices of the level index
+ *  @param  price the price looked for in every lane
+ *
+ *  Asks are lowest first
+ */
+inline Vec8ib prices_ahead(const Vec8ui& prices,const Vec8ui& price,LessComp) {
+	return prices < price;
+}
+
+/**
+ *  @brief  Vectorized lower bound of a price in a sorted level index
+ *  @tparam Compare GreaterComp for bids and LessComp for asks
+ *  @param  index prices sorted best first
+ *  @param  price to look for
+ *  @return position of the price or where it would go
+ *
+ *  A binary search narrows a long index down to a few vectors, then the
+ *  prices are compared 8 at a time. As the index is sorted the number of
+ *  lanes ahead of the price is its position in the vector, the first
+ *  vector with any lane not ahead holds the bound. Using VCL as included
+ *  in vectorclass sub dir.
+ *
+ */
+template<typename Compare>
+inline std::size_t price_lower_bound(const std::vector<PriceLevelKey>& index,const PriceLevelKey& price,Compare comp) {
+	static_assert(sizeof(PriceLevelKey)==sizeof(uint32_t),"Prices are compared as Vec8ui");
+	const PriceLevelKey* data=index.data();
+	std::size_t first=0;
+	std::size_t count=index.size();
+
+	// Binary search until we are within 4 vectors
+	while (count > 32) {
+		std::size_t half=count/2;
+		if (comp(data[first+half],price)) {
+			first+=half+1;
+			count-=half+1;
+		}
+		else {
+			count=half;
+		}
+	}
+
+	// Count the prices ahead a vector at a time
+	Vec8ui key(price), prices;
+	for (; count >= 8; first+=8, count-=8) {
+		prices.load(data+first);
+		std::size_t ahead=horizontal_count(prices_ahead(prices,key,comp));
+		if (ahead < 8) {
+			return first+ahead;
+		}
+	}
+
+	// The remainder that does not fill a vector
+	for (; count > 0 && comp(data[first],price); first++, count--) {
+	}
+	return first;
+}
+
+/**
+   *  @brief Represent the price levels of one side of the book kept in
+   *  price order, best first.
+   *
+   *  The same 2 vectors as the @see VectorPriceLevels, the level_index of
+   *  prices and the orders at the same position, but the level_index is
+   *  kept sorted, bids descending and asks ascending. A price is found with
+   *  the vectorized @see price_lower_bound rather than a scan of every
+   *  price, the top of the book is index 0 and the levels behind it follow
+   *  in order.
+   *
+   *  Adding or removing a level moves the levels behind it but levels
+   *  change far less often than they are looked up.
+   *
+   *  @tparam Orders the orders at a price level
+   *  @tparam Compare GreaterComp for bids and LessComp for asks
+   */
+template<typename Orders, typename Compare>
+struct SortedPriceLevels {
+	// Orders mapped by following price key vector
+	std::vector<Orders> levels;
+	// Prices best first
+	std::vector<PriceLevelKey> level_index;
+
+	/**
+	 *  @brief  Enquire to see if any price levels exist
+	 *
+	 */
+	bool empty() const {
+		return level_index.empty();
+	}
+
+	/**
+	 *  @brief  Enquire to see how many price levels
+	 *
+	 */
+	std::size_t size() const {
+		return level_index.size();
+	}
+
+	/**
+	 *  @brief  Position of a price or where it would go
+	 *  @param  price key to look for
+	 *
+	 */
+	std::size_t lower_bound(const PriceLevelKey& price) const {
+		return price_lower_bound(level_index,price,Compare());
+	}
+
+	/**
+	 *  @brief  Find how many of a particular price exist (0 or 1)
+	 *  @param  price the price level we are looking for
+	 *
+	 */
+	std::size_t count(const PriceLevelKey& price) const {
+		std::size_t position=lower_bound(price);
+		return position < level_index.size() && level_index[position]==price;
+	}
+
+	/**
+	 *  @brief  Remove a price level
+	 *  @param  price the price level is we want to remove
+	 *
+	 *  Removes the price key and corresponding orders, the levels behind
+	 *  move up
+	 *
+	 */
+	void erase(const PriceLevelKey& price) {
+		std::size_t position=lower_bound(price);
+		if (position < level_index.size() && level_index[position]==price) {
+			levels.erase(levels.begin()+position);
+			level_index.erase(level_index.begin()+position);
+			assert(level_index.size()==levels.size());
+		}
+	}
+
+	/**
+	 *  @brief  operator to get or create the price key
+	 *  		and Orders element in the vector
+	 *  @param  price key for the orders to get or create
+	 *  @return The modifiable reference to the
+	 *          orders for the price
+	 *
+	 *  A new price is inserted in its place in the order
+	 *
+	 */
+	Orders&
+    operator[](const PriceLevelKey& price)
+    {
+		std::size_t position=lower_bound(price);
+		if (position==level_index.size() || level_index[position]!=price) {
+			level_index.insert(level_index.begin()+position,price);
+			levels.emplace(levels.begin()+position);
+			assert(level_index.size()==levels.size());
+		}
+		return levels[position];
+    }
+
+	/**
+	 *  @brief  operator to get the orders
+	 *  		element in the vector
+	 *  @param  price key for orders
+	 *  @return The read only reference to the orders
+	 *
+	 */
+	const Orders&
+    operator[](const PriceLevelKey& price) const
+    {
+		std::size_t position=lower_bound(price);
+		if (position==level_index.size() || level_index[position]!=price) {
+			throw std::out_of_range("Price:"+std::to_string(price));
+		}
+		return levels[position];
+    }
+
+	/**
+	 *  @brief  The best price or PriceLevelKey{} when there are no levels
+	 *
+	 */
+	PriceLevelKey best() const {
+		return level_index.empty() ? PriceLevelKey{} : level_index.front();
+	}
+
+	/**
+	 *  @brief  Clear the underlying orderbook data structure
+	 *
+	 */
+	void clear() {
+		levels.clear();
+		level_index.clear();
+	}
+};
+
+/**
+ *  @brief   Next price level behind a price
+ *  @param   levels the sorted price levels of one side
+ *  @param   price to search from, PriceLevelKey{} for the best price
+ *  @param   comp GreaterComp for bids and LessComp for asks
+ *  @return  the next worse price
+ *
+ *  The level index is in order so this is the price after the lower bound
+ */
+template<typename Orders, typename Compare>
+inline PriceLevelKey next_level(SortedPriceLevels<Orders,Compare> & levels,const PriceLevelKey& price,Compare comp) {
+	if (price==PriceLevelKey{}) {
+		return levels.best();
+	}
+	std::size_t position=levels.lower_bound(price);
+	if (position < levels.level_index.size() && levels.level_index[position]==price) {
+		position++;
+	}
+	return position < levels.level_index.size() ? levels.level_index[position] : PriceLevelKey{};
+}
+
+#endif
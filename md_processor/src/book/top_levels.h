@@ -0,0 +1,176 @@
+#ifndef top_levels_h
+#define top_levels_h
+
+#include <cstring>
+
+#include "md_basic_types.h"
+
+/**
+ *  @brief   Next price level behind a price
+ *  @tparam  PriceLevels Type of underlying price data
+ *  @param   levels the price levels of one side
+ *  @param   price to search from, PriceLevelKey{} for the best price
+ *  @param   comp GreaterComp for bids and LessComp for asks
+ *  @return  the next worse price
+ *
+ *  This is the default used by unsorted containers such as BookHash which
+ *  have to look at every price
+ */
+template<typename PriceLevels, typename Compare>
+inline PriceLevelKey next_level(PriceLevels & levels,const PriceLevelKey& price,Compare comp) {
+	PriceLevelKey next{};
+	for (auto & level : levels) {
+		if ((price==PriceLevelKey{} || comp(price,level.first)) &&
+			(next==PriceLevelKey{} || comp(level.first,next))) {
+			next=level.first;
+		}
+	}
+	return next;
+}
+
+/**
+ *  @brief   Next price level behind a price
+ *  @param   levels the price levels of one side
+ *  @param   price to search from, PriceLevelKey{} for the best price
+ *  @param   comp GreaterComp for bids and LessComp for asks
+ *  @return  the next worse price
+ *
+ *  The std::map levels of BookMap are already in order
+ */
+template<typename Orders, typename Compare, typename Allocator>
+inline PriceLevelKey next_level(std::map<PriceLevelKey,Orders,Compare,Allocator> & levels,const PriceLevelKey& price,Compare comp) {
+	auto next = price==PriceLevelKey{} ? levels.begin() : levels.upper_bound(price);
+	return next==levels.end() ? PriceLevelKey{} : next->first;
+}
+
+/**
+   *  @brief The best price levels of one side of the book, aggregated.
+   *
+   *  Holds up to max_levels of price, number of orders and total quantity
+   *  in the same form as BookData so a snapshot of the book is just a copy
+   *  of these arrays. The OrderBook applies every change of orders and
+   *  quantity at a price as it happens so we never have to go back to the
+   *  price levels and sort or sum them.
+   *
+   *  The levels held are always the best min(max_levels, levels in book)
+   *  so when one of them goes we refill the last place from the book with
+   *  @see next_level.
+   *
+   *  @tparam Compare GreaterComp for bids (best is highest) and LessComp
+   *  for asks (best is lowest)
+   */
+template<typename Compare>
+struct TopLevels {
+	/**
+	 *  @brief  Apply a change to the level at a price
+	 *  @tparam PriceLevels Type of underlying price data
+	 *  @param  price the price level that changed
+	 *  @param  orders change in the number of orders
+	 *  @param  quantity change in the total quantity
+	 *  @param  sideLevels the book side after the change
+	 *  @return the first level that changed or max_levels if the
+	 *          change was behind the levels we hold
+	 *
+	 */
+	template<typename PriceLevels>
+	std::size_t update(const PriceLevelKey& price,int orders,int quantity,PriceLevels & sideLevels) {
+		std::size_t i=0;
+		// Look for the price or where it would go
+		while (i < count && Compare()(prices[i],price)) {
+			i++;
+		}
+
+		if (i < count && prices[i]==price) {
+			contr[i]+=orders;
+			quantities[i]+=quantity;
+			if (contr[i]==0) {
+				// Level has gone so fill the last place from the book
+				remove(i);
+				if (sideLevels.size() > count) {
+					PriceLevelKey next=next_level(sideLevels,count ? prices[count-1] : PriceLevelKey{},Compare());
+					auto & level=sideLevels[next];
+					set(count++,next,level.size(),sum(level));
+				}
+			}
+			// A modify to the same quantity leaves the level as it was
+			return orders || quantity ? i : max_levels;
+		}
+		else if (i < max_levels && orders > 0) {
+			// A new level which is within the top, make room for it
+			if (count==max_levels) {
+				count--;
+			}
+			for (std::size_t j=count; j > i; j--) {
+				set(j,prices[j-1],contr[j-1],quantities[j-1]);
+			}
+			set(i,price,orders,quantity);
+			count++;
+			return i;
+		}
+		return max_levels;
+	}
+
+	/**
+	 *  @brief  Copy the top n levels into BookData arrays
+	 *  @tparam n Number of levels
+	 *
+	 *  Unused levels are left as 0
+	 *
+	 */
+	template<std::size_t n>
+	void copy(std::array<int,n> & book_contr,std::array<int,n> & book_quantity,std::array<double,n> & book_price) const {
+		static_assert(n <= max_levels,"Order book may not be bigger than 20 levels");
+		std::memcpy(book_contr.data(),contr.data(),sizeof(int)*n);
+		std::memcpy(book_quantity.data(),quantities.data(),sizeof(int)*n);
+		std::memcpy(book_price.data(),dprices.data(),sizeof(double)*n);
+	}
+
+	/**
+	 *  @brief  The best price or PriceLevelKey{} when there are no levels
+	 *
+	 */
+	PriceLevelKey best() const noexcept {
+		return count ? prices[0] : PriceLevelKey{};
+	}
+
+	/**
+	 *  @brief  Remove all the levels
+	 *
+	 */
+	void clear() {
+		prices.fill(PriceLevelKey{});
+		dprices.fill(0);
+		contr.fill(0);
+		quantities.fill(0);
+		count=0;
+	}
+
+private:
+	void set(std::size_t i,const PriceLevelKey& price,int orders,int quantity) {
+		prices[i]=price;
+		dprices[i]=price;
+		contr[i]=orders;
+		quantities[i]=quantity;
+	}
+
+	void remove(std::size_t i) {
+		count--;
+		for (; i < count; i++) {
+			set(i,prices[i+1],contr[i+1],quantities[i+1]);
+		}
+		set(count,PriceLevelKey{},0,0);
+	}
+
+	// Prices of the levels best first
+	std::array<PriceLevelKey,max_levels> prices{};
+	// Prices as BookData holds them
+	DArrray<max_levels> dprices{};
+	// Number of orders at each level
+	IArrray<max_levels> contr{};
+	// Total quantity at each level
+	IArrray<max_levels> quantities{};
+	// Number of levels held
+	std::size_t count{};
+};
+
+#endif
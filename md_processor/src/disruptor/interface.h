@@ -136,6 +136,12 @@ template<typename T>
 class EventFactoryInterface {
  public:
      virtual T* NewInstance(const int& size) const = 0;
+
+     // Called by the {@link RingBuffer} to release the events, a factory
+     // which does not allocate with new[] must override this.
+     virtual void DeleteInstance(T* events, const int& size) const {
+         delete[] events;
+     }
 };
 
 // Callback interface to be implemented for processing events as they become
@@ -62,11 +62,12 @@ class RingBuffer : public Sequencer {
                       wait_strategy_option),
             buffer_size_(buffer_size),
             mask_(buffer_size - 1),
+            event_factory_(event_factory),
             events_(event_factory->NewInstance(buffer_size)) {
     }
 
     ~RingBuffer() {
-        delete[] events_;
+        event_factory_->DeleteInstance(events_, buffer_size_);
     }
 
     // Get the event for a given sequence in the RingBuffer.
@@ -81,6 +82,7 @@ class RingBuffer : public Sequencer {
     // Members
     int buffer_size_;
     int mask_;
+    EventFactoryInterface<T>* event_factory_;
     T* events_;
 
     DISALLOW_COPY_AND_ASSIGN(RingBuffer);
@@ -5,6 +5,10 @@
 #include <log4cxx/xml/domconfigurator.h>
 #include <log4cxx/ndc.h>
 
+#include <map>
+#include <string>
+#include <string_view>
+
 #include <boost/version.hpp>
 
 #if BOOST_VERSION >= 104400
@@ -13,6 +17,8 @@
 #include <boost/exception.hpp>
 #endif
 
+#include "md_async_log.h"
+
 using namespace std;
 using namespace log4cxx;
 
@@ -60,4 +66,38 @@ protected:
 	const std::string _msg;
 };
 
+/**
+ * @brief Writes the records of the async log through log4cxx, each to
+ * the logger of its format at its level, on the log thread
+ */
+class Log4cxxLogWriter : public LogWriter {
+public:
+	virtual void write(const LogRecord & record, std::string_view line) {
+		LogFormatInfo info=log_format_info(record.format);
+		LoggerPtr & logger=loggers[info.logger];
+		if (!logger) {
+			logger=Logger::getLogger(info.logger);
+		}
+		std::string text(line);
+		switch (info.level) {
+		case LogLevel::Info:
+			LOG_INFO(logger, text);
+			break;
+		case LogLevel::Warn:
+			LOG_WARN(logger, text);
+			break;
+		case LogLevel::Error:
+			LOG_ERROR(logger, text);
+			break;
+		case LogLevel::Fatal:
+			LOG_FATAL(logger, text);
+			break;
+		}
+	}
+
+private:
+	// Logger of each logger name
+	std::map<std::string_view,LoggerPtr> loggers;
+};
+
 #endif /* LOGGINGI_H_ */
@@ -6,7 +6,10 @@
 #include <string>
 
 #include "md_handler.h"
+#include "md_sharded_handler.h"
+#include "md_pipelined_handler.h"
 #include "md_adapters.h"
+#include "md_stats_export.h"
 
 #include <queue>
 
@@ -39,18 +42,24 @@ static PrintType char2printtype(char print_type) {
 
 void print_usage() {
 	std::string message =
-{R"(Usage: md_processor [ [ -f <file name> -a [F|M] ] | [ZR|ZP|ZS] ] [-p T|C] [-d M|H|V] [-x L] [-t A|S|C]  -s [ [P|D|N ] | [U --publish_address=<address>] ]                   
+{R"(Usage: md_processor [ [ -f <file name> -a [F|M] ] | [ZR|ZP|ZS] ] [-p T|C] [-d M|H|V|I|S|L] [-x L|M] [-t A|S|C|B]  -s [ [P|D|N ] | [U --publish_address=<address>] ]                   
        -f is name of file to stream the input
          The file name can be relative or absolute
        -p is for the type of print out put you wish to see
          T is a text book and C is a csv format output
        -d selects the underlying book structure to test
-         M is a map, H is a hash and V is vector base data structures
+         M is a map, H is a hash, V is vector and L is a price ladder base data structures,
+         I is the vector with the orders of a level held in place rather than in vectors,
+         S is the vector with the price levels kept in price order
        -x select the type of parser model to test
          L is the simple token list parse for csv text or json line formats
+         M is the token list with an instrument id first for a feed of many instruments,
+         each instrument has its own book
        -t select the type of token container use in test
-         A is a json_spirit based array, S is a strtk string vector and C is a custom char* vector
-         Important - When using json_spirit it will expect a json file where S and C expect csv.
+         A is a json_spirit based array, S is a strtk string vector, C is a custom char* vector
+         and B is the fields of a binary message
+         Important - When using json_spirit it will expect a json file where S and C expect csv
+         and B a .bin file (see data/md2bin).
        -a select the adapter to source the market data
          F is a file based input
          M is memory mapped file based input
@@ -64,6 +73,28 @@ void print_usage() {
          D is the disruptor
          N is none action publisher
          U is udp publisher
+       --batch=N processes F and M adapter input N messages at a time and only publishes
+         each book the batch applied to at its end, --publish_each still publishes every message
+       --conflate only publishes an add, modify or cancel when the top 5 levels change
+       --coalesce=LAG with D holds only the latest mid and book while the consumer is
+         more than LAG events behind, trades are always published
+       --hugepages with D puts the ring buffer on huge pages and --prefault faults in its
+         pages at startup rather than during the run
+       --consumers=LIST with D selects the consumers of the ring buffer, P print, U udp
+         (needs --publish_address), J journal to --journal=<file> and A analytics. Consumers
+         separated by ',' run in parallel and one after a ':' waits for the one before it,
+         i.e --consumers=P,J:A, the default is P
+       --shards=K with -x M splits the instruments over K threads, each with its own books,
+         with D each shard journals to <file>.<shard> and prints its own analytics
+       --pipeline with -x L reads, parses and applies to the book in three threads one after
+         the other, --cpus=R,P,B pins the read, parse and book threads to those cpus
+         Both are for the -t C or B tokenizers and the F or M adapters
+       --latency prints percentiles of the time to process a message by stage, by event and all,
+         not for --pipeline or --batch
+       --log_file=FILE writes the reports of rejected messages and the diagnostics to FILE
+         with their time rather than to stderr and log4cxx
+       --stats_file=FILE writes the message and error rates, book depth and error counts to FILE
+         every --stats_interval=MS milliseconds, 1000 by default, while running
 )"};
     printf(message.c_str());
 }
@@ -100,9 +131,11 @@ md(int argc, char **argv) {
 		// If we are using csv then either 'C' character or string 'S' would be valid
 		// With json only json array 'A'
 		std::string f(file_name);
+		bool binary = f.length()>4 && f.substr(f.length()-4,f.length())==".bin";
 		if (
-			(f.substr(f.length()-4,f.length())==".csv" && tokenizer=="A") ||
-			(f.substr(f.length()-5,f.length())==".json" && (tokenizer=="C" || tokenizer=="S"))
+			(f.substr(f.length()-4,f.length())==".csv" && (tokenizer=="A" || tokenizer=="B")) ||
+			(f.substr(f.length()-5,f.length())==".json" && (tokenizer=="C" || tokenizer=="S" || tokenizer=="B")) ||
+			(binary && tokenizer!="B")
 		)
 		{
 			printf("Bad combination of tokenizer and file type\n");
@@ -117,6 +150,25 @@ md(int argc, char **argv) {
 		exit(EXIT_FAILURE);
 	}
 
+	// Are the consumers of the disruptor valid
+	if (consumer_chains(args.get_opt<std::string>("consumers", optional_arg, has_arg, "P")).empty()) {
+		printf("Bad consumers\n");
+		print_usage();
+		exit(EXIT_FAILURE);
+	}
+
+	// Reports of rejected messages stay on stderr and diagnostics go through
+	// log4cxx unless both are to go to a file
+	std::string log_file = args.get_opt<std::string>("log_file", optional_arg, has_arg, "");
+	if (not log_file.empty()) {
+		auto writer=std::make_shared<FileLogWriter>(log_file);
+		async_log().set_writer(LogChannel::Reports,writer);
+		async_log().set_writer(LogChannel::Diagnostics,writer);
+	}
+	else {
+		async_log().set_writer(LogChannel::Diagnostics,std::make_shared<Log4cxxLogWriter>());
+	}
+
 	// Start the test by configuring the options then passing it on to run
 	select_publisher_and_run(file_name,adapter,data_struct,parser,tokenizer,publisher,print_type,args);
 }
@@ -136,12 +188,21 @@ int run(MD &md, Adapter &adapter, PrintType printType,const arguments& args)
 	struct timeval stop_time_;
 
 	md.start(printType,args);
+	// Process messages in batches publishing only the books at the end of each batch
+	// unless publish_each is given
+	adapter.set_batch(args.get_opt<std::size_t>("batch", optional_arg, has_arg, 0),
+			args.get_opt<bool>("publish_each", optional_arg, no_arg, false));
 	adapter.wait();
+	StatsExporter exporter(args);
 	::gettimeofday(&start_time_, NULL);
 	adapter.start(md);
+	md.finish();
 	::gettimeofday(&stop_time_, NULL);
+	// The rejected messages are reported before anything else
+	async_log().flush();
 	adapter.stop();
 	md.stop();
+	exporter.stop();
 
 	double total_micros = ((1e6 * (stop_time_.tv_sec  - start_time_.tv_sec )) + (stop_time_.tv_usec - start_time_.tv_usec));
 	std::cerr << "Time to process " << adapter.get_counter() << " messages => " << total_micros << " micros\n";
@@ -159,13 +220,12 @@ int run(MD &md, Adapter &adapter, PrintType printType,const arguments& args)
  * @param printType
  * @param adapter
  */
-template <typename TokenContainer, typename Parser, typename BookContainer, typename Publisher>
+template <typename TokenContainer, typename MD>
 void select_adapter_and_run(const std::string& file_name,
-		md_handler<Parser,BookContainer,Publisher> &md,
+		MD &md,
 		const std::string& adapter,
 		PrintType printType,
 		const arguments& args) {
-	typedef md_handler<Parser,BookContainer,Publisher> MD;
 
 	if (adapter == "F") {
 		file_adapter<TokenContainer,MD> adapter(file_name.c_str());
@@ -190,6 +250,85 @@ void select_adapter_and_run(const std::string& file_name,
 	}
 }
 
+/**
+ * Select the file adapter for the handlers that spread the work over
+ * threads, --shards and --pipeline are for replaying files as fast as
+ * possible so they are not built for every adapter.
+ *
+ * @param file_name
+ * @param md
+ * @param printType
+ * @param adapter
+ */
+template <typename TokenContainer, typename MD>
+void select_file_adapter_and_run(const std::string& file_name,
+		MD &md,
+		const std::string& adapter,
+		PrintType printType,
+		const arguments& args) {
+
+	if (adapter == "F") {
+		file_adapter<TokenContainer,MD> adapter(file_name.c_str());
+		run(md,adapter,printType,args);
+	} else if (adapter == "M") {
+		memorymapped_file_adapter<TokenContainer,MD> adapter(file_name.c_str());
+		run(md,adapter,printType,args);
+	} else {
+		// Only files are split over threads
+		print_usage();
+		exit(EXIT_FAILURE);
+	}
+}
+
+/**
+ * Select one md handler or, with --shards for a parser with instruments,
+ * the instruments split over shards each with their own handler or, with
+ * --pipeline for the list parser, the handler split into stages.
+ *
+ * The shards and pipeline are only built for the tokenizers that work
+ * in place, C and B, and the file adapters, the combinations they are
+ * there to speed up, as every handler is built for every adapter, book
+ * and publisher.
+ *
+ * @param file_name File/device we use for parsing
+ * @param adapter The adapter for the source of data i.e file or pcap etc
+ * @param print_type type print format type
+ */
+template <typename TokenContainer, typename Publisher, typename Parser, typename BookContainer>
+void select_handler_and_run(const std::string& file_name,
+		const std::string & adapter,
+		PrintType print_type,
+		const arguments& args) {
+	constexpr bool in_place=std::is_same<TokenContainer, char_token_vector>::value ||
+			std::is_same<TokenContainer, binary_token_vector>::value;
+	std::size_t shards=args.get_opt<std::size_t>("shards", optional_arg, has_arg, 1);
+	if (args.get_opt<bool>("pipeline", optional_arg, no_arg, false)) {
+		if constexpr (in_place && std::is_same<Parser, list_parser>::value) {
+			pipelined_md_handler<TokenContainer, Parser, BookContainer, Publisher> md_handler(
+					cpu_list(args.get_opt<std::string>("cpus", optional_arg, has_arg, "")));
+			select_file_adapter_and_run<TokenContainer>(file_name, md_handler, adapter, print_type,args);
+			return;
+		}
+		// Only a single book feed read in place is pipelined
+		print_usage();
+		exit(EXIT_FAILURE);
+	}
+	if constexpr (in_place && std::is_same<Parser, instrument_list_parser>::value) {
+		if (shards > 1) {
+			sharded_md_handler<TokenContainer, Parser, BookContainer, Publisher> md_handler(shards);
+			select_file_adapter_and_run<TokenContainer>(file_name, md_handler, adapter, print_type,args);
+			return;
+		}
+	}
+	if (shards > 1) {
+		// Only messages with an instrument read in place are split
+		print_usage();
+		exit(EXIT_FAILURE);
+	}
+	md_handler<Parser, BookContainer, Publisher> md_handler;
+	select_adapter_and_run<TokenContainer>(file_name, md_handler, adapter, print_type,args);
+}
+
 /**
  * Select the data structure we want to use for underlying book.
  *
@@ -198,28 +337,32 @@ void select_adapter_and_run(const std::string& file_name,
  * @param adapter The adapter for the source of data i.e file or pcap etc
  * @param print_type type print format type
  */
-template <typename TokenContainer, typename Publisher>
+template <typename TokenContainer, typename Publisher, typename Parser>
 void select_data_structure_and_run(const std::string& file_name,
 		const std::string & adapter,
 		const std::string & data_struct,
 		PrintType print_type,
 		const arguments& args) {
 	if (data_struct == "M") {
-		md_handler<list_parser, BookMap, Publisher> md_handler;
-		select_adapter_and_run<TokenContainer>(file_name, md_handler, adapter, print_type,args);
+		select_handler_and_run<TokenContainer, Publisher, Parser, BookMap>(file_name, adapter, print_type,args);
 	} else if (data_struct == "H") {
-		md_handler<list_parser, BookHash, Publisher> md_handler;
-		select_adapter_and_run<TokenContainer>(file_name, md_handler, adapter, print_type,args);
+		select_handler_and_run<TokenContainer, Publisher, Parser, BookHash>(file_name, adapter, print_type,args);
 	} else if (data_struct == "V") {
-		md_handler<list_parser, BookVector, Publisher> md_handler;
-		select_adapter_and_run<TokenContainer>(file_name, md_handler, adapter, print_type,args);
+		select_handler_and_run<TokenContainer, Publisher, Parser, BookVector>(file_name, adapter, print_type,args);
+	} else if (data_struct == "I") {
+		select_handler_and_run<TokenContainer, Publisher, Parser, BookVectorInline>(file_name, adapter, print_type,args);
+	} else if (data_struct == "S") {
+		select_handler_and_run<TokenContainer, Publisher, Parser, BookVectorSorted>(file_name, adapter, print_type,args);
+	} else if (data_struct == "L") {
+		select_handler_and_run<TokenContainer, Publisher, Parser, BookLadder>(file_name, adapter, print_type,args);
 	} else {
 		print_usage();
 	}
 }
 
 /**
- * Select the parser model we want, L is the basic simple list.
+ * Select the parser model we want, L is the basic simple list and M the same list
+ * for many instruments.
  * Betfair or other trading exchanges may have much more complex models
  *
  * @param file_name File/device we use for parsing
@@ -236,7 +379,11 @@ void select_parser_and_run(const std::string& file_name,
 		PrintType print_type,
 		const arguments& args) {
 	if (parser == "L") {
-		select_data_structure_and_run<TokenContainer,Publisher>(file_name,adapter,data_struct,print_type,args);
+		select_data_structure_and_run<TokenContainer,Publisher,list_parser>(file_name,adapter,data_struct,print_type,args);
+	}
+	else if (parser == "M") {
+		// Many instruments, the list with the instrument first
+		select_data_structure_and_run<TokenContainer,Publisher,instrument_list_parser>(file_name,adapter,data_struct,print_type,args);
 	}
 	// Other parser specific to the shape of the data
 	else {
@@ -275,6 +422,10 @@ void select_token_method_and_run(const std::string& file_name,
 		// Tokenized csv char * vector
 		select_parser_and_run<char_token_vector,Publisher>(file_name,adapter,data_struct,parser,print_type,args);
 	}
+	else if(tokenizer=="B") {
+		// Binary message fields
+		select_parser_and_run<binary_token_vector,Publisher>(file_name,adapter,data_struct,parser,print_type,args);
+	}
 	else {
 		print_usage();
 		exit(EXIT_FAILURE);
@@ -0,0 +1,634 @@
+#ifndef md_async_log_h
+#define md_async_log_h
+
+#include <stdint.h>
+#include <time.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "disruptor/interface.h"
+#include "disruptor/sequence.h"
+
+#include "md_basic_types.h"
+#include "tokenizer/binary_token_vector.h"
+
+/**
+ * @brief Level of a log record
+ */
+enum class LogLevel : char {
+	Info='I',
+	Warn='W',
+	Error='E',
+	Fatal='F'
+};
+
+/**
+ * @brief Where the records of a format are written, the reports of rejected
+ * messages are part of the output of the processor, the diagnostics are
+ * for whoever runs it
+ */
+enum class LogChannel : char {
+	Reports,
+	Diagnostics
+};
+
+/**
+ * @brief The format of a log record, the record only carries the id and
+ * the arguments, the text is made from them by the log thread
+ * @see format_log_record
+ */
+enum class LogFormat : uint16_t {
+	// MessageError, message, line number
+	MessageRejected,
+	// Exception text, message, line number
+	MessageException,
+	// Address
+	UdpAddingPublisher,
+	UdpOpenedSocket,
+	// Error code
+	UdpOpenFailed,
+	// Error code
+	UdpSendFailed
+};
+
+/**
+ * @brief What is known of each format besides its text
+ */
+struct LogFormatInfo {
+	LogLevel level;
+	LogChannel channel;
+	// Name of the logger the format belongs to, for log4cxx
+	const char* logger;
+};
+
+/**
+ * The level, channel and logger of a format
+ * @param format
+ */
+inline LogFormatInfo log_format_info(LogFormat format) {
+	switch (format) {
+	case LogFormat::MessageRejected:
+	case LogFormat::MessageException:
+		return {LogLevel::Error,LogChannel::Reports,"md_handler"};
+	case LogFormat::UdpAddingPublisher:
+	case LogFormat::UdpOpenedSocket:
+		return {LogLevel::Info,LogChannel::Diagnostics,"udp_publisher"};
+	case LogFormat::UdpOpenFailed:
+		return {LogLevel::Fatal,LogChannel::Diagnostics,"udp_publisher"};
+	case LogFormat::UdpSendFailed:
+		return {LogLevel::Warn,LogChannel::Diagnostics,"udp_publisher"};
+	}
+	return {LogLevel::Info,LogChannel::Diagnostics,"md_processor"};
+}
+
+/**
+ * @brief A log record as it goes through the ring, fixed size and written
+ * with nothing more than copies so logging costs no allocation,
+ * formatting or I/O on the thread that logs.
+ *
+ * The arguments are kept in the order given, numbers and enums as
+ * integers and strings copied into text. The text holds the longest
+ * message the parsers accept with the text of an exception, a string
+ * that still does not fit is cut short and marked as cut so the report
+ * never looks complete when it is not.
+ *
+ */
+struct LogRecord {
+	// Numbers and strings a record can carry
+	static constexpr std::size_t max_args=4;
+	static constexpr std::size_t max_strings=2;
+	// Longest message accepted, a snapshot of max_levels levels with an
+	// instrument id, every field 10 digits and, for json, quoted
+	static constexpr std::size_t max_message_size=(5+6*max_levels)*(10+3)+2;
+	// Room for the text of an exception
+	static constexpr std::size_t max_exception_size=256;
+	// Room for the strings
+	static constexpr std::size_t text_size=max_message_size+max_exception_size;
+
+	/**
+	 * Start a record
+	 * @param format of the record
+	 */
+	void start(LogFormat log_format) noexcept {
+		format=log_format;
+		arg_count=0;
+		string_count=0;
+		text_used=0;
+		cut_strings=0;
+		struct timespec ts;
+		::clock_gettime(CLOCK_REALTIME, &ts);
+		timestamp=uint64_t(ts.tv_sec)*1000000000+ts.tv_nsec;
+	}
+
+	/**
+	 * Add a number or enum argument
+	 */
+	template <typename T>
+	typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+	add(T value) noexcept {
+		if (arg_count < max_args) {
+			args[arg_count++]=static_cast<int64_t>(value);
+		}
+	}
+
+	/**
+	 * Add a string argument
+	 */
+	void add(std::string_view value) noexcept {
+		if (string_count < max_strings) {
+			uint16_t length=std::min(value.size(),text_size-text_used);
+			::memcpy(text+text_used,value.data(),length);
+			if (length < value.size()) {
+				cut_strings|=1 << string_count;
+			}
+			strings[string_count++]={text_used,length};
+			text_used+=length;
+		}
+	}
+
+	void add(const char* value) noexcept {
+		add(std::string_view(value));
+	}
+
+	void add(const std::string& value) noexcept {
+		add(std::string_view(value));
+	}
+
+	/**
+	 * A string argument
+	 * @param i position among the strings
+	 */
+	std::string_view string(std::size_t i) const noexcept {
+		return i < string_count ? std::string_view(text+strings[i].first,strings[i].second) : std::string_view();
+	}
+
+	/**
+	 * Was a string argument cut short
+	 * @param i position among the strings
+	 */
+	bool cut(std::size_t i) const noexcept {
+		return i < string_count && (cut_strings & (1 << i));
+	}
+
+	/**
+	 * A number argument
+	 * @param i position among the numbers
+	 */
+	int64_t arg(std::size_t i) const noexcept {
+		return i < arg_count ? args[i] : 0;
+	}
+
+	// Nanoseconds since the epoch when logged
+	uint64_t timestamp;
+	LogFormat format;
+	uint8_t arg_count;
+	uint8_t string_count;
+	// Bit of each string cut short
+	uint8_t cut_strings;
+	uint16_t text_used;
+	// Offset and length in text of each string
+	std::array<std::pair<uint16_t,uint16_t>,max_strings> strings;
+	int64_t args[max_args];
+	char text[text_size];
+};
+
+/**
+ * Append a message as text, a message of the binary format (-t B) as its
+ * fields in decimal separated by ',' in the order of a csv line, and any
+ * other byte that is not printable as \xHH so the reports and the log
+ * file stay text
+ *
+ * @param line to append to
+ * @param message the message as it was read, possibly cut short
+ */
+inline void append_message_text(std::string & line, std::string_view message) {
+	bool printable=std::all_of(message.begin(),message.end(),
+			[](char c) { return c >= ' ' && c <= '~'; });
+	if (printable) {
+		line.append(message);
+		return;
+	}
+	if (binary_message_length(message.data(),message.size())==message.size()) {
+		binary_header header;
+		std::memcpy(&header,message.data(),sizeof(header));
+		std::size_t count=le16toh(header.count);
+		if (sizeof(binary_header)+count*sizeof(uint32_t)==message.size()) {
+			for (std::size_t i=0; i < count; i++) {
+				uint32_t field;
+				std::memcpy(&field,message.data()+sizeof(binary_header)+i*sizeof(uint32_t),sizeof(field));
+				if (i > 0) {
+					line.push_back(',');
+				}
+				line.append(std::to_string(le32toh(field)));
+			}
+			return;
+		}
+	}
+	static constexpr char hex[]="0123456789abcdef";
+	for (char c : message) {
+		if (c >= ' ' && c <= '~' && c != '\\') {
+			line.push_back(c);
+		}
+		else {
+			line.append("\\x");
+			line.push_back(hex[uint8_t(c) >> 4]);
+			line.push_back(hex[uint8_t(c) & 0xf]);
+		}
+	}
+}
+
+// Follows a string that was cut short
+constexpr std::string_view log_cut_marker="...[truncated]";
+
+/**
+ * Append a string argument of a record, marked if it was cut short
+ *
+ * @param line to append to
+ * @param record
+ * @param i position among the strings
+ */
+inline void append_string(std::string & line, const LogRecord & record, std::size_t i) {
+	line.append(record.string(i));
+	if (record.cut(i)) {
+		line.append(log_cut_marker);
+	}
+}
+
+/**
+ * Append a message argument of a record as text, marked if it was cut short
+ * @see append_message_text
+ *
+ * @param line to append to
+ * @param record
+ * @param i position among the strings
+ */
+inline void append_message(std::string & line, const LogRecord & record, std::size_t i) {
+	append_message_text(line,record.string(i));
+	if (record.cut(i)) {
+		line.append(log_cut_marker);
+	}
+}
+
+/**
+ * Make the text of a record from its format and arguments
+ *
+ * @param record
+ * @param line cleared and set to the text, without a new line
+ */
+inline void format_log_record(const LogRecord & record, std::string & line) {
+	line.clear();
+	switch (record.format) {
+	case LogFormat::MessageRejected:
+		line.append("Caught exception: ").append(message_error_text(static_cast<MessageError>(record.arg(0))))
+			.append(" for event(");
+		append_message(line,record,0);
+		line.append(") line number:").append(std::to_string(record.arg(1)));
+		break;
+	case LogFormat::MessageException:
+		line.append("Caught exception: ");
+		append_string(line,record,0);
+		line.append(" for event(");
+		append_message(line,record,1);
+		line.append(") line number:").append(std::to_string(record.arg(0)));
+		break;
+	case LogFormat::UdpAddingPublisher:
+		line.append("Adding publisher:").append(record.string(0));
+		break;
+	case LogFormat::UdpOpenedSocket:
+		line.append("Opened socket");
+		break;
+	case LogFormat::UdpOpenFailed:
+		line.append("Failed to open socket - error code [").append(std::to_string(record.arg(0))).append("]");
+		break;
+	case LogFormat::UdpSendFailed:
+		line.append("Failed to send book data - error code [").append(std::to_string(record.arg(0))).append("]");
+		break;
+	}
+}
+
+/**
+ * @brief Writes the text of the records, called only from the log thread
+ */
+class LogWriter {
+public:
+	virtual ~LogWriter() = default;
+
+	/**
+	 * Write a record
+	 * @param record the record with its timestamp and format
+	 * @param line the text of the record
+	 */
+	virtual void write(const LogRecord & record, std::string_view line)=0;
+
+	/**
+	 * Make sure everything written is out
+	 */
+	virtual void flush() {}
+};
+
+/**
+ * @brief Writes the text of each record on a line of a stream, as
+ * the reports have always been written to std::cerr
+ */
+class StreamLogWriter : public LogWriter {
+public:
+	explicit StreamLogWriter(std::ostream & ostr) : ostr(ostr) {
+	}
+
+	virtual void write(const LogRecord & record, std::string_view line) {
+		ostr << line << "\n";
+	}
+
+	virtual void flush() {
+		ostr << std::flush;
+	}
+
+private:
+	std::ostream & ostr;
+};
+
+/**
+ * @brief Writes each record to a file with its time, level and logger
+ *
+ *   2024-05-01 09:30:00.123456789 E md_handler Caught exception: ...
+ *
+ */
+class FileLogWriter : public LogWriter {
+public:
+	explicit FileLogWriter(const std::string & path) : file(::fopen(path.c_str(),"a")) {
+		if (file==nullptr) {
+			throw std::runtime_error("Cannot open log file");
+		}
+	}
+	virtual ~FileLogWriter() {
+		::fclose(file);
+	}
+
+	virtual void write(const LogRecord & record, std::string_view line) {
+		time_t seconds=record.timestamp/1000000000;
+		struct tm time;
+		::localtime_r(&seconds,&time);
+		char stamp[32];
+		::strftime(stamp,sizeof(stamp),"%Y-%m-%d %H:%M:%S",&time);
+		LogFormatInfo info=log_format_info(record.format);
+		::fprintf(file,"%s.%09lu %c %s %.*s\n",stamp,record.timestamp%1000000000,
+				static_cast<char>(info.level),info.logger,static_cast<int>(line.size()),line.data());
+	}
+
+	virtual void flush() {
+		::fflush(file);
+	}
+
+private:
+	FILE* file;
+};
+
+/**
+   *  @brief Ring of records from one thread to the log thread, single
+   *  producer and single consumer.
+   *
+   *  The producer and consumer positions are on their own cache lines and
+   *  each side keeps a copy of the other's so the shared lines are only
+   *  read when the copy says the ring is full or empty.
+   *
+   */
+class LogRing {
+public:
+	LogRing() : records(new LogRecord[capacity]) {
+	}
+
+	/**
+	 * The record to write next, waits for the log thread if the
+	 * ring is full so nothing is lost
+	 */
+	LogRecord & claim() noexcept {
+		if (unlikely(tail-head_cache == capacity)) {
+			while ((head_cache=head.load(std::memory_order_acquire)) == tail-capacity) {
+				std::this_thread::yield();
+			}
+		}
+		return records[tail & (capacity-1)];
+	}
+
+	/**
+	 * Hand the claimed record to the log thread
+	 */
+	void publish() noexcept {
+		tail++;
+		published.store(tail,std::memory_order_release);
+	}
+
+	/**
+	 * The oldest record not yet written, only for the log thread
+	 * @return the record or nullptr if there is none
+	 */
+	const LogRecord* front() noexcept {
+		if (head_read == tail_cache) {
+			tail_cache=published.load(std::memory_order_acquire);
+			if (head_read == tail_cache) {
+				return nullptr;
+			}
+		}
+		return &records[head_read & (capacity-1)];
+	}
+
+	/**
+	 * Done with the front record, only for the log thread
+	 */
+	void pop() noexcept {
+		head_read++;
+		head.store(head_read,std::memory_order_release);
+	}
+
+	/**
+	 * Has the log thread written everything published
+	 */
+	bool empty() const noexcept {
+		return head.load(std::memory_order_acquire) == published.load(std::memory_order_acquire);
+	}
+
+private:
+	// Records the ring holds, a power of 2
+	static constexpr uint64_t capacity=1<<10;
+
+	std::unique_ptr<LogRecord[]> records;
+	// Producer side, the next record to write and the last head seen
+	alignas(CACHE_LINE_SIZE_IN_BYTES) uint64_t tail=0;
+	uint64_t head_cache=0;
+	alignas(CACHE_LINE_SIZE_IN_BYTES) std::atomic<uint64_t> published{0};
+	// Consumer side, the next record to read and the last tail seen
+	alignas(CACHE_LINE_SIZE_IN_BYTES) uint64_t head_read=0;
+	uint64_t tail_cache=0;
+	alignas(CACHE_LINE_SIZE_IN_BYTES) std::atomic<uint64_t> head{0};
+};
+
+/**
+   *  @brief Asynchronous binary logging, the thread that logs only fills
+   *  a fixed record in a ring of its own and a log thread makes the text
+   *  and writes it.
+   *
+   *  Each thread that logs gets a @see LogRing the first time it logs,
+   *  after that logging takes no lock and does no allocation, formatting
+   *  or I/O, so a burst of bad messages does not stall the book thread on
+   *  the terminal. The log thread takes the oldest record of all the rings
+   *  so the records of different threads come out in time order.
+   *
+   *  Reports are written to std::cerr and diagnostics to std::clog unless
+   *  other writers are given i.e log4cxx or a file.
+   *
+   */
+class AsyncLog {
+public:
+	AsyncLog() {
+		writers[static_cast<int>(LogChannel::Reports)]=std::make_shared<StreamLogWriter>(std::cerr);
+		writers[static_cast<int>(LogChannel::Diagnostics)]=std::make_shared<StreamLogWriter>(std::clog);
+		log_thread=std::thread([this] { run(); });
+	}
+
+	~AsyncLog() {
+		running.store(false,std::memory_order_release);
+		log_thread.join();
+		write_ready();
+	}
+
+	AsyncLog(const AsyncLog&) = delete;
+	AsyncLog& operator=(const AsyncLog&) = delete;
+
+	/**
+	 * Log a record
+	 *
+	 * @param format of the record
+	 * @param args numbers, enums and strings the format needs
+	 */
+	template <typename... Args>
+	void log(LogFormat format, const Args&... args) noexcept {
+		LogRing & ring=thread_ring();
+		LogRecord & record=ring.claim();
+		record.start(format);
+		(record.add(args), ...);
+		ring.publish();
+	}
+
+	/**
+	 * Write the records of a channel with the writer given from now on
+	 *
+	 * @param channel
+	 * @param writer
+	 */
+	void set_writer(LogChannel channel, std::shared_ptr<LogWriter> writer) {
+		std::lock_guard<std::mutex> lock(mutex);
+		writers[static_cast<int>(channel)]=std::move(writer);
+	}
+
+	/**
+	 * Wait until everything logged so far has been written, once the
+	 * threads logging are done and before anything else is written to
+	 * the same place, so the reports come first
+	 */
+	void flush() {
+		for (;;) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (std::all_of(rings.begin(),rings.end(),[](const std::unique_ptr<LogRing> & ring) { return ring->empty(); })) {
+					for (auto & writer : writers) {
+						writer->flush();
+					}
+					return;
+				}
+			}
+			std::this_thread::yield();
+		}
+	}
+
+private:
+	// How long the log thread sleeps when there is nothing to write
+	static constexpr std::chrono::microseconds idle_sleep{500};
+
+	/**
+	 * The ring of the calling thread, there is one log so one ring
+	 * for each thread
+	 */
+	LogRing & thread_ring() {
+		static thread_local LogRing* ring=nullptr;
+		if (unlikely(ring==nullptr)) {
+			std::lock_guard<std::mutex> lock(mutex);
+			rings.emplace_back(std::make_unique<LogRing>());
+			ring=rings.back().get();
+		}
+		return *ring;
+	}
+
+	/**
+	 * The log thread, writes records as they arrive until stopped
+	 */
+	void run() {
+		while (running.load(std::memory_order_acquire)) {
+			if (not write_ready()) {
+				std::this_thread::sleep_for(idle_sleep);
+			}
+		}
+	}
+
+	/**
+	 * Write the records ready, oldest first over all the rings
+	 * @return true if any were written
+	 */
+	bool write_ready() {
+		std::lock_guard<std::mutex> lock(mutex);
+		bool any=false;
+		for (;;) {
+			LogRing* oldest=nullptr;
+			const LogRecord* oldest_record=nullptr;
+			for (auto & ring : rings) {
+				const LogRecord* record=ring->front();
+				if (record && (oldest_record==nullptr || record->timestamp < oldest_record->timestamp)) {
+					oldest=ring.get();
+					oldest_record=record;
+				}
+			}
+			if (oldest==nullptr) {
+				return any;
+			}
+			format_log_record(*oldest_record,line);
+			writers[static_cast<int>(log_format_info(oldest_record->format).channel)]->write(*oldest_record,line);
+			oldest->pop();
+			any=true;
+		}
+	}
+
+	// Guards the rings and writers between the log thread and the rest
+	std::mutex mutex;
+	// A ring for each thread that has logged
+	std::vector<std::unique_ptr<LogRing>> rings;
+	// Writer of each channel
+	std::array<std::shared_ptr<LogWriter>,2> writers;
+	// Text of the record being written, kept for its capacity
+	std::string line;
+	// Write until stopped
+	std::atomic<bool> running{true};
+	// Writes the records
+	std::thread log_thread;
+};
+
+/**
+ * The log of the process, the log thread starts with the first use
+ */
+inline AsyncLog& async_log() {
+	static AsyncLog log;
+	return log;
+}
+
+#endif
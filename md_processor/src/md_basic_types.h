@@ -12,6 +12,7 @@
 #include <utility>
 #include <numeric>
 #include <algorithm>
+#include <stdexcept>
 
 #include "md_helper.h"
 
@@ -33,6 +34,11 @@ constexpr OrderIdKeyType max_order_id=1e8;
 constexpr QuantityValueType max_order_quantity=500;
 // 2000 as example
 constexpr PriceLevelKey max_order_price=2000;
+// Instrument (market) id as unsigned 32 bit, 0 is the single book of a feed
+// without instruments
+typedef uint32_t InstrumentId;
+// 1 million markets as example, the books are indexed directly by id
+constexpr InstrumentId max_instrument_id=1e6;
 
 /**
  *  @brief The enumerated side type as char Bid or Ask
@@ -70,6 +76,81 @@ enum class PrintType : char {
 	Unknown='U'
 };
 
+/**
+ *  @brief Why a message was rejected, returned by the parsers and the
+ *  order book instead of throwing so a bad message costs no more than
+ *  a good one. None is a message without error.
+ *
+ */
+enum class MessageError : char {
+	None,
+	Corruption,
+	InstrumentRange,
+	InstrumentSyntax,
+	OrderIdRange,
+	OrderIdSyntax,
+	SideSyntax,
+	OrderQuantityRange,
+	OrderQuantitySyntax,
+	OrderPriceRange,
+	OrderPriceSyntax,
+	ContributorsSyntax,
+	TradeQuantityRange,
+	TradeQuantitySyntax,
+	TradePriceRange,
+	TradePriceSyntax,
+	NoTradeMatchingOrder,
+	NoOrderMatchingTrade
+};
+
+/**
+ * The text of an error as it is reported
+ *
+ * @param error
+ * @return the text, never formatted so nothing is allocated
+ */
+inline const char* message_error_text(MessageError error) {
+	switch (error) {
+	case MessageError::None:
+		return "None";
+	case MessageError::Corruption:
+		return "Corruption";
+	case MessageError::InstrumentRange:
+		return "Instrument range";
+	case MessageError::InstrumentSyntax:
+		return "Instrument syntax";
+	case MessageError::OrderIdRange:
+		return "Order id range";
+	case MessageError::OrderIdSyntax:
+		return "Order id syntax";
+	case MessageError::SideSyntax:
+		return "Order side syntax";
+	case MessageError::OrderQuantityRange:
+		return "Order quantity range";
+	case MessageError::OrderQuantitySyntax:
+		return "Order quantity syntax";
+	case MessageError::OrderPriceRange:
+		return "Order price range";
+	case MessageError::OrderPriceSyntax:
+		return "Order price syntax";
+	case MessageError::ContributorsSyntax:
+		return "Order number of contributors syntax";
+	case MessageError::TradeQuantityRange:
+		return "Trade quantity range";
+	case MessageError::TradeQuantitySyntax:
+		return "Trade quantity syntax";
+	case MessageError::TradePriceRange:
+		return "Trade price range";
+	case MessageError::TradePriceSyntax:
+		return "Trade price is syntax";
+	case MessageError::NoTradeMatchingOrder:
+		return "No trade matching order";
+	case MessageError::NoOrderMatchingTrade:
+		return "No order matching trade";
+	}
+	return "Unknown";
+}
+
 
 /**
  *  @brief The order properties extracted from event
@@ -96,6 +177,29 @@ typedef struct {
 
 typedef std::vector<Trade> Trades;
 
+/**
+ *  @brief A message parsed but not yet applied to the order book
+ *
+ *  The order and trade events are fixed size, only a snapshot has its
+ *  orders and trades in vectors. event is Unknown until the whole
+ *  message has parsed.
+ *
+ */
+struct ParsedMessage {
+	// Instrument of the book the message is for
+	InstrumentId instrument{};
+	// Event of the message
+	Event event{Event::Unknown};
+	// Order of an add, modify or cancel
+	Order order{};
+	// Trade of a trade event
+	Trade trade{};
+	// Orders of a snapshot
+	Orders orders;
+	// Trades of a snapshot
+	Trades trades;
+};
+
 /**
  *  @brief Pending match order
  *
@@ -148,6 +252,8 @@ struct BookData {
 	Trade total_traded_quantity{};
 	// Event that cause the publish
 	Event event{Event::Unknown};
+	// Instrument of the book or 0 when the feed has only one book
+	InstrumentId instrument{};
 };
 
 /**
@@ -164,6 +270,46 @@ inline auto sum(Orders & orders) -> QuantityValueType {
 	return std::accumulate(orders.begin(), orders.end(), 0, f);
 }
 
+/**
+   *  @brief The orders at a price level for the map containers with a running
+   *  total of their quantities.
+   *
+   *  The total is kept by the order helpers @see insert_order, change_quantity
+   *  and erase_order so the sum of a level does not have to visit the orders.
+   *  The number of orders is the map size() which is already kept.
+   *
+   *  @tparam OrderMap map of order id to quantity
+   */
+template<typename OrderMap>
+struct LevelOrders : public OrderMap {
+	// Sum of the order quantities in the level
+	QuantityValueType total{};
+
+	void clear() {
+		OrderMap::clear();
+		total=0;
+	}
+};
+
+/**
+ *  @brief   This is the sum template used by the map containers
+ *  @tparam  OrderMap map of order id to quantity
+ *  @param   orders Orders type used in the sum
+ *  @return	 the sum of the order quantities
+ *
+ *  The running total, if __VERIFY_LEVEL_SUM__ is defined then it is checked
+ *  against summing the orders
+ */
+template<typename OrderMap>
+inline auto sum(LevelOrders<OrderMap> & orders) -> QuantityValueType {
+#ifdef __VERIFY_LEVEL_SUM__
+	if (orders.total!=sum(static_cast<OrderMap&>(orders))) {
+		throw std::runtime_error("Level total does not match the orders");
+	}
+#endif
+	return orders.total;
+}
+
 /**
  *  @brief   This is the specialized sum template used by vector of quanties as the BookVector has
  *  @tparam  Orders This is the BookContainers internal data structure for the orders
@@ -0,0 +1,87 @@
+#ifndef book_manager_h
+#define book_manager_h
+
+#include <stdint.h>
+#include <vector>
+
+#include "md_order_book.h"
+
+/**
+   *  @brief The order books of all the instruments in a feed.
+   *
+   *  The books are held one after another in a vector in the order the
+   *  instruments are first seen so they are dense however sparse the ids
+   *  are. Finding the book for an instrument id is a flat index straight
+   *  into the position of its book, ids are bounded by max_instrument_id
+   *  so the index is never more than one int per possible id.
+   *
+   *  A feed without instruments has only the book for instrument 0.
+   *
+   *  @tparam  BookContainer  Type of underlying book data
+   *  structure we can use and defaults the BookMap.
+   */
+template <typename BookContainer=BookMap>
+class BookManager {
+public:
+	typedef OrderBook<BookContainer> Book;
+
+	/**
+	 *  @brief  Get the book for an instrument
+	 *  @param  instrument id of the instrument
+	 *  @return the book, created empty the first time the instrument is seen
+	 *
+	 *  The reference is only good until a book for a new instrument is
+	 *  created as the books may be moved, hold the instrument instead
+	 */
+	Book& book(InstrumentId instrument) {
+		if (likely(instrument < index.size() && index[instrument])) {
+			return books[index[instrument]-1];
+		}
+		return add(instrument);
+	}
+
+	/**
+	 *  @brief  Number of instruments with a book
+	 *
+	 */
+	std::size_t size() const noexcept {
+		return books.size();
+	}
+
+	/**
+	 *  @brief  Apply a function to every book in the order they were created
+	 *  @param  f callable taking a Book&
+	 *
+	 */
+	template<typename F>
+	void for_each(F f) {
+		for (auto & b : books) {
+			f(b);
+		}
+	}
+
+private:
+	/**
+	 *  @brief  Create the book for a new instrument
+	 *  @param  instrument id of the instrument
+	 *  @return the new book
+	 *
+	 */
+	Book& add(InstrumentId instrument) {
+		if (instrument >= index.size()) {
+			index.resize(instrument+1);
+		}
+		books.emplace_back();
+		books.back().set_instrument(instrument);
+		// Position plus one so zero is no book
+		index[instrument]=books.size();
+		return books.back();
+	}
+
+	// The books in the order the instruments were seen
+	std::vector<Book> books;
+	// Position of the book plus one for each instrument id, 0 if none
+	std::vector<uint32_t> index;
+};
+
+#endif
@@ -1,4 +1,7 @@
 
+#include "book/order_index.h"
+#include "book/top_levels.h"
 #include "book/book_map.h"
 #include "book/book_hash.h"
 #include "book/book_vector.h"
+#include "book/book_ladder.h"
@@ -0,0 +1,36 @@
+#ifndef md_error_log_h
+#define md_error_log_h
+
+#include <exception>
+#include <string_view>
+
+#include "md_async_log.h"
+
+/**
+ * Report a message rejected by the parser or book, only the error code,
+ * line number and a copy of the message go on the log ring, the report
+ * is made and written by the log thread
+ *
+ *   Caught exception: <error> for event(<message>) line number:<n>
+ *
+ * @param error why it was rejected
+ * @param message the message that failed
+ * @param line_number where the message was in the input
+ */
+inline void report_message_error(MessageError error, std::string_view message, int line_number) {
+	async_log().log(LogFormat::MessageRejected, error, message, line_number);
+}
+
+/**
+ * Report a message that failed with an exception, i.e from a tokenizer,
+ * in the same form
+ *
+ * @param e the failure
+ * @param message the message that failed
+ * @param line_number where the message was in the input
+ */
+inline void report_message_error(std::exception const& e, std::string_view message, int line_number) {
+	async_log().log(LogFormat::MessageException, e.what(), message, line_number);
+}
+
+#endif
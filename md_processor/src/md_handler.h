@@ -3,10 +3,13 @@
 #define md_handler_h
 
 #include <iostream>
+#include <vector>
 
 #include "md_types.h"
+#include "md_error_log.h"
 #include "md_parsers.h"
-#include "md_order_book.h"
+#include "md_book_manager.h"
+#include "md_latency.h"
 #include "md_publishers.h"
 #include "arguments.h"
 
@@ -16,6 +19,9 @@
    *  Controls the print publisher and message processing which
    *  is sent to the order book
    *
+   *  Each message is routed to the order book of its instrument, with
+   *  the list parser a feed has no instruments so there is only one book
+   *
    */
 template <typename Parser=list_parser, typename BookContainer=BookMap,typename Publisher=print_publisher<>>
 class md_handler {
@@ -30,6 +36,10 @@ public:
     	if (not std::is_same<null_publisher, Publisher>::value) {
     		publisher=std::make_unique<Publisher>(printType,args);
     	}
+    	conflate=args.get_opt<bool>("conflate", optional_arg, no_arg, false);
+    	if (args.get_opt<bool>("latency", optional_arg, no_arg, false)) {
+    		latency=std::make_unique<LatencyStats>();
+    	}
     }
 
     /**
@@ -40,80 +50,470 @@ public:
      * data events for publishing
      *
      * @param iter
+     * @return None or why the message was rejected, nothing is published then
      */
     template <typename TokenContainer>
-    void process_message(TokenContainer && tokens) {
+    MessageError process_message(TokenContainer && tokens) {
+    	Event event{Event::Unknown};
+    	MessageError error=apply_message(tokens, event);
+    	if (likely(error==MessageError::None)) {
+    		publish(event);
+    	}
+    	return error;
+    }
+
+    /**
+     * Tokenize a message and process it
+     *
+     * When measuring latency each stage is timed separately,
+     * parsing the message before applying it to the book
+     *
+     * A message the parser or book rejects goes to the error log, only
+     * a tokenizer that throws is left for the adapter to report
+     *
+     * @param line the message
+     * @param line_number of the message in the input for the error log
+     */
+    template <typename TokenContainer, typename Line>
+    void process_line(const Line & line, int line_number) {
+    	stats().message();
+    	if (unlikely(latency.get() != nullptr)) {
+    		std::array<uint64_t,LatencyStats::Stages+1> times;
+    		times[LatencyStats::Tokenize]=latency_clock();
+    		TokenContainer tokens=get_tokens<TokenContainer>(line);
+    		times[LatencyStats::Parse]=latency_clock();
+    		MessageError error=parse_message(tokens, parsed);
+    		times[LatencyStats::Book]=latency_clock();
+    		if (likely(error==MessageError::None)) {
+    			error=apply_parsed(parsed);
+    		}
+    		if (unlikely(error!=MessageError::None)) {
+    			report_message_error(error, line, line_number);
+    			return;
+    		}
+    		times[LatencyStats::Publish]=latency_clock();
+    		publish(parsed.event);
+    		times[LatencyStats::Stages]=latency_clock();
+    		latency->record(parsed.event, times);
+    		return;
+    	}
+    	MessageError error=process_message(get_tokens<TokenContainer>(line));
+    	if (unlikely(error!=MessageError::None)) {
+    		report_message_error(error, line, line_number);
+    	}
+    }
+
+    /**
+     * Tokenize a batch of messages and process them together
+     * @see process_batch
+     *
+     * A message which does not tokenize is reported and left out
+     *
+     * @param lines the messages of the batch
+     * @param n number of messages
+     * @param line_number of the first message in the input
+     * @param publish_each publish after every message rather than once
+     * @param on_error called with the position in lines and the exception
+     *        or error for a message that fails
+     */
+    template <typename TokenContainer, typename Line, typename OnError>
+    void process_lines(const Line* lines, std::size_t n, int line_number, bool publish_each, OnError on_error) {
+    	// Tokens and the line each came from
+    	std::vector<TokenContainer> tokens;
+    	std::vector<std::size_t> positions;
+    	tokens.reserve(n);
+    	positions.reserve(n);
+    	for (std::size_t i=0; i < n; i++) {
+    		stats().message();
+    		try
+    		{
+    			tokens.emplace_back(get_tokens<TokenContainer>(lines[i]));
+    			positions.push_back(i);
+    		}
+    		catch(std::exception const& e)
+    		{
+    			on_error(i, e);
+    		}
+    	}
+
+    	process_batch(tokens.begin(), tokens.end(), publish_each,
+    		[&](std::size_t position, MessageError error) {
+    			on_error(positions[position], error);
+    		});
+    }
+
+    /**
+     * Everything is processed as it is given so nothing to wait for
+     */
+    void finish() {
+    }
+
+    /**
+     * Apply a batch of tokenized messages to the order book
+     *
+     * The messages are applied in order and a message that fails is
+     * reported and skipped, as it would be one at a time. Publishing is
+     * either for each message or only once for each book the batch
+     * applied to, with the last event applied to it, which saves
+     * publishing states nobody needs i.e a backtest only interested in
+     * the books at the end of each batch. The books are published in the
+     * order the batch first applied to them.
+     *
+     * @param first first message of the batch
+     * @param last end of the batch
+     * @param publish_each publish after every message rather than once
+     * @param on_error called with the position in the batch and the error
+     *        for a message that fails
+     */
+    template <typename Iterator, typename OnError>
+    void process_batch(Iterator first, Iterator last, bool publish_each, OnError on_error) {
+    	Event event{Event::Unknown};
+    	for (Iterator message=first; message != last; ++message) {
+    		MessageError error=apply_message(*message, event);
+    		if (unlikely(error!=MessageError::None)) {
+    			on_error(message-first, error);
+    			continue;
+    		}
+    		if (publish_each) {
+    			publish(event);
+    		}
+    		else {
+    			batch_applied(event);
+    		}
+    	}
+
+    	if (not publish_each && not batch_books.empty()) {
+    		// The books are found again by instrument as the book of a
+    		// new instrument may have moved them
+    		InstrumentId last_instrument=ob->get_instrument();
+    		for (auto & applied : batch_books) {
+    			ob=&books.book(applied.instrument);
+    			snapshot_traded=applied.snapshot_traded;
+    			publish(applied.event);
+    			batch_position[applied.instrument]=0;
+    		}
+    		batch_books.clear();
+    		// Left as the book of the last message applied
+    		ob=&books.book(last_instrument);
+    	}
+    }
+
+    /**
+     * Get the instrument and event and apply it to the order book
+     * of the instrument, nothing is published
+     *
+     * @param tokens the message
+     * @param event the event applied
+     * @return None or why the message was rejected
+     */
+    template <typename TokenContainer>
+    MessageError apply_message(TokenContainer & tokens, Event & event) {
 		auto message_iter = tokens.begin();
 		auto end = tokens.end();
-        Event event = Parser::get_event(message_iter,end);
+		InstrumentId instrument{};
+		MessageError error = Parser::get_instrument(message_iter,end,instrument);
+		if (likely(error==MessageError::None)) {
+			error = Parser::get_event(message_iter,end,event);
+		}
+		if (unlikely(error!=MessageError::None)) {
+			return error;
+		}
 
+		// Parse the message before looking up the book so a message that
+		// fails never creates a book for its instrument
+		Order order{};
+		Trade trade{};
 		switch (event) {
 		default:
 			break;
 		case Event::Add:
-			ob.add(Parser::get_order(message_iter,end));
-			if (publisher.get()) {
-				publisher->offer(ob.mid_data());
-				publisher->offer(ob.book_data());
-			}
+		case Event::Modify:
+		case Event::Cancel:
+			error = Parser::get_order(message_iter,end,order);
+			break;
+		case Event::Trade:
+			error = Parser::get_trade(message_iter,end,trade);
+			break;
+		case Event::Snapshot:
+			error = Parser::get_trades(message_iter,end,snapshot_trades);
+			break;
+		}
+		if (unlikely(error!=MessageError::None)) {
+			return error;
+		}
+
+        // Published from the book of the last message applied
+        ob = &books.book(instrument);
+
+		switch (event) {
+		default:
+			break;
+		case Event::Add:
+			error = ob->add(std::move(order));
 			break;
 		case Event::Modify:
-			ob.modify(Parser::get_order(message_iter,end));
-			if (publisher.get()) {
-				publisher->offer(ob.mid_data());
-				publisher->offer(ob.book_data());
-			}
+			ob->modify(std::move(order));
 			break;
 		case Event::Cancel:
-			ob.cancel(Parser::get_order(message_iter,end));
-			if (publisher.get()) {
-				publisher->offer(ob.mid_data());
-				publisher->offer(ob.book_data());
+			ob->cancel(std::move(order));
+			break;
+		case Event::Trade:
+			error = ob->trade(std::move(trade));
+			break;
+		case Event::Snapshot:
+			// Trades are applied even if the orders then fail, as they always have been
+			snapshot_traded = ob->snapshot_trades(std::move(snapshot_trades));
+			error = Parser::get_orders(message_iter,end,snapshot_orders);
+			if (likely(error==MessageError::None)) {
+				ob->snapshot_orders(std::move(snapshot_orders));
 			}
 			break;
+		}
+		return error;
+    }
+
+    /**
+     * Parse a message into a record which can be applied later,
+     * possibly in another thread @see apply_parsed
+     *
+     * @param tokens the message
+     * @param parsed the record to fill
+     * @return None or why the message was rejected, the event is
+     *         left Unknown then
+     */
+    template <typename TokenContainer>
+    static MessageError parse_message(TokenContainer & tokens, ParsedMessage & parsed) {
+		auto message_iter = tokens.begin();
+		auto end = tokens.end();
+		parsed.event = Event::Unknown;
+		Event event{Event::Unknown};
+		MessageError error = Parser::get_instrument(message_iter,end,parsed.instrument);
+		if (likely(error==MessageError::None)) {
+			error = Parser::get_event(message_iter,end,event);
+		}
+		if (unlikely(error!=MessageError::None)) {
+			return error;
+		}
+
+		switch (event) {
+		default:
+			break;
+		case Event::Add:
+		case Event::Modify:
+		case Event::Cancel:
+			error = Parser::get_order(message_iter,end,parsed.order);
+			break;
 		case Event::Trade:
-			ob.trade(Parser::get_trade(message_iter,end));
-			if (publisher.get()) {
-				publisher->offer(ob.trade_data());
-				publisher->offer(ob.mid_data());
+			error = Parser::get_trade(message_iter,end,parsed.trade);
+			break;
+		case Event::Snapshot:
+			error = Parser::get_trades(message_iter,end,parsed.trades);
+			if (likely(error==MessageError::None)) {
+				error = Parser::get_orders(message_iter,end,parsed.orders);
 			}
 			break;
+		}
+		// Only once the whole message is good
+		if (likely(error==MessageError::None)) {
+			parsed.event = event;
+		}
+		return error;
+    }
+
+    /**
+     * Apply a parsed message to the order book of the instrument,
+     * nothing is published
+     *
+     * @param parsed the record from parse_message, a snapshot
+     *        has its orders and trades moved out
+     * @return None or why the book rejected the message
+     */
+    MessageError apply_parsed(ParsedMessage & parsed) {
+        // Published from the book of the last message applied
+        ob = &books.book(parsed.instrument);
+
+		switch (parsed.event) {
+		default:
+			break;
+		case Event::Add:
+			return ob->add(Order(parsed.order));
+		case Event::Modify:
+			ob->modify(Order(parsed.order));
+			break;
+		case Event::Cancel:
+			ob->cancel(Order(parsed.order));
+			break;
+		case Event::Trade:
+			return ob->trade(Trade(parsed.trade));
 		case Event::Snapshot:
-			bool traded = ob.snapshot_trades(Parser::get_trades(message_iter,end));
-			ob.snapshot_orders(Parser::get_orders(message_iter,end));
-			if (publisher.get()) {
-				if (unlikely(traded)) {
-					publisher->offer(ob.trade_data());
-				}
-				else {
-					publisher->offer(ob.book_data());
+			snapshot_traded = ob->snapshot_trades(std::move(parsed.trades));
+			ob->snapshot_orders(std::move(parsed.orders));
+			break;
+		}
+		return MessageError::None;
+    }
+
+    /**
+     * Offer the data events for the book of the last message after an event
+     *
+     * In a batch each book applied to is published once at the end when
+     * not publishing each message.
+     *
+     * When conflating an add, modify or cancel is only published if it
+     * changed what would be published, the mid for the top of the book
+     * and the book for the first conflate_levels. Changes are collected
+     * by the order book since the last publish so they are not lost over
+     * a batch. Trades and snapshots are always published.
+     *
+     * @param event the last event applied
+     */
+    void publish(Event event) {
+    	if (not publisher.get() || not ob) {
+    		return;
+    	}
+
+		switch (event) {
+		default:
+			break;
+		case Event::Add:
+		case Event::Modify:
+		case Event::Cancel:
+			if (not conflate) {
+				publish_mid();
+				publish_book();
+			}
+			else if (ob->levels_changed(conflate_levels)) {
+				if (ob->levels_changed(1)) {
+					publish_mid();
 				}
+				publish_book();
+			}
+			break;
+		case Event::Trade:
+			publish_trade();
+			publish_mid();
+			break;
+		case Event::Snapshot:
+			if (unlikely(snapshot_traded)) {
+				publish_trade();
+			}
+			else {
+				publish_book();
 			}
 			break;
 		}
+		ob->reset_changed();
     }
 
     /**
      * Offers the book data off for publishing
      */
     void publishOrderBook() {
-    	if (publisher.get())
-    		publisher->offer(ob.book_data());
+    	if (publisher.get() && ob)
+    		publish_book();
      }
 
     /**
-     * Prints the stats onto the stream given
+     * Prints the stats onto the stream given, those of every
+     * thread added up
      * @param ostr output stream
      */
     void printStats(std::ostream &ostr) {
-        stats().print(ostr);
+        total_stats().print(ostr);
+        if (latency.get()) {
+        	latency->print(ostr);
+        }
+    }
+
+    /**
+     * The latencies measured
+     * @return the latencies or nullptr if not measured
+     */
+    const LatencyStats* latency_stats() const {
+    	return latency.get();
     }
 
 	private:
-    	// OrderBook template for a particular container
-    	OrderBook<BookContainer> ob;
+    	/**
+    	 * @brief A book a batch has applied to, with the last event and
+    	 * whether that was a snapshot with a trade, to be published at
+    	 * the end of the batch
+    	 */
+    	struct BatchBook {
+    		InstrumentId instrument;
+    		Event event;
+    		bool snapshot_traded;
+    	};
+
+    	/**
+    	 * Record the book of the message just applied to be published at
+    	 * the end of the batch, a book already in the batch only has its
+    	 * event replaced
+    	 *
+    	 * @param event the event applied
+    	 */
+    	void batch_applied(Event event) {
+    		InstrumentId instrument=ob->get_instrument();
+    		if (instrument >= batch_position.size()) {
+    			batch_position.resize(instrument+1);
+    		}
+    		uint32_t & position=batch_position[instrument];
+    		if (position==0) {
+    			batch_books.push_back({instrument,event,snapshot_traded});
+    			position=batch_books.size();
+    		}
+    		else {
+    			batch_books[position-1].event=event;
+    			batch_books[position-1].snapshot_traded=snapshot_traded;
+    		}
+    	}
+
+    	/**
+    	 * Write the book data of the book into the data claimed from
+    	 * the publisher and publish it, the same for the mid and trade
+    	 */
+    	void publish_book() {
+    		ob->book_data(publisher->claim());
+    		publisher->publish();
+    	}
+
+    	void publish_mid() {
+    		ob->mid_data(publisher->claim());
+    		publisher->publish();
+    	}
+
+    	void publish_trade() {
+    		ob->trade_data(publisher->claim());
+    		publisher->publish();
+    	}
+
+    	// Levels published in the book data, changes behind these are
+    	// not published when conflating
+    	static constexpr std::size_t conflate_levels=5;
+
+    	// OrderBook for each instrument for a particular container
+    	BookManager<BookContainer> books;
+    	// Book of the last message applied or nullptr before the first
+    	OrderBook<BookContainer>* ob=nullptr;
     	// The publisher which handles book data messages
     	std::unique_ptr<Publisher> publisher;
+    	// Did the last snapshot carry a trade
+    	bool snapshot_traded=false;
+    	// Only publish when the published levels change
+    	bool conflate=false;
+    	// Latency of each message when measured with --latency
+    	std::unique_ptr<LatencyStats> latency;
+    	// Message being timed, kept to reuse the snapshot vectors
+    	ParsedMessage parsed;
+    	// Orders and trades of the snapshot being applied
+    	Orders snapshot_orders;
+    	Trades snapshot_trades;
+    	// Books the batch being processed has applied to, in the order
+    	// first applied to
+    	std::vector<BatchBook> batch_books;
+    	// Position in batch_books plus one of each instrument, 0 if the
+    	// batch has not applied to its book
+    	std::vector<uint32_t> batch_position;
 };
 
 typedef md_handler<> MDHandler;
@@ -1,7 +1,14 @@
 #ifndef md_helper_h
 #define md_helper_h
 
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 /**
  *
@@ -95,6 +102,109 @@ reverse_range<T> reverse_iterate(T& x) {
 	return reverse_range<T>(x);
 }
 
+/**
+ * Pin a thread to a cpu so it is not moved between cores
+ *
+ * @param thread the thread i.e std::thread::native_handle or pthread_self
+ * @param cpu the cpu to run on, a negative cpu leaves the thread as it is
+ */
+inline void pin_thread(pthread_t thread, int cpu) {
+	if (cpu < 0) {
+		return;
+	}
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu, &cpus);
+	if (::pthread_setaffinity_np(thread, sizeof(cpus), &cpus) != 0) {
+		throw std::runtime_error("Cannot pin thread to cpu " + std::to_string(cpu));
+	}
+}
+
+/**
+ * Split a comma separated list of cpus i.e "2,3,4"
+ *
+ * @param list the cpus
+ * @return the cpus in order, empty for an empty list
+ */
+inline std::vector<int> cpu_list(const std::string& list) {
+	std::vector<int> cpus;
+	std::size_t start=0;
+	while (start < list.size()) {
+		std::size_t end=list.find(',', start);
+		if (end == std::string::npos) {
+			end=list.size();
+		}
+		cpus.push_back(std::stoi(list.substr(start, end-start)));
+		start=end+1;
+	}
+	return cpus;
+}
+
+// Size of a huge page, ring memory backed by huge pages is a multiple of it
+constexpr std::size_t huge_page_size=2*1024*1024;
+
+/**
+ * Size of the mapping for ring memory, whole pages
+ *
+ * @param bytes size needed
+ * @param hugepages round to huge pages
+ * @return the size mapped
+ */
+inline std::size_t ring_memory_size(std::size_t bytes, bool hugepages) {
+	std::size_t page=hugepages ? huge_page_size : static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+	return (bytes+page-1)/page*page;
+}
+
+/**
+ * Map memory for a ring buffer rather than take it from the heap
+ *
+ * With hugepages the memory is from the reserved huge pages
+ * (/proc/sys/vm/nr_hugepages) or if there are none transparent huge
+ * pages are asked for instead. With prefault every page is touched now
+ * so the run does not take the page faults.
+ *
+ * @param bytes size needed
+ * @param hugepages back the memory with huge pages
+ * @param prefault fault in every page now
+ * @return the memory, page aligned and zeroed
+ */
+inline void* map_ring_memory(std::size_t bytes, bool hugepages, bool prefault) {
+	std::size_t size=ring_memory_size(bytes,hugepages);
+	void* memory=MAP_FAILED;
+	if (hugepages) {
+		memory=::mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+	}
+	if (memory==MAP_FAILED) {
+		memory=::mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		if (memory==MAP_FAILED) {
+			throw std::bad_alloc();
+		}
+		if (hugepages) {
+			::madvise(memory, size, MADV_HUGEPAGE);
+		}
+	}
+	if (prefault) {
+		volatile char* page=static_cast<char*>(memory);
+		// Every small page in case transparent huge pages are not given
+		std::size_t step=ring_memory_size(1,false);
+		for (std::size_t i=0; i < size; i+=step) {
+			page[i]=0;
+		}
+	}
+	return memory;
+}
+
+/**
+ * Unmap memory from @see map_ring_memory
+ *
+ * @param memory the ring memory
+ * @param bytes size it was mapped for
+ * @param hugepages as it was mapped
+ */
+inline void unmap_ring_memory(void* memory, std::size_t bytes, bool hugepages) {
+	::munmap(memory, ring_memory_size(bytes,hugepages));
+}
+
 // Branch prediction
 #define likely(x)       __builtin_expect((x),1)
 #define unlikely(x)     __builtin_expect((x),0)
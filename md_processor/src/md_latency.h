@@ -0,0 +1,241 @@
+#ifndef md_latency_h
+#define md_latency_h
+
+#include <stdint.h>
+#include <time.h>
+#include <array>
+#include <cstdio>
+#include <iostream>
+
+#include "md_types.h"
+
+/**
+ * @brief Log linear histogram of latencies in nanoseconds
+ *
+ * As the HDR histogram, values are bucketed by their highest bit and then
+ * linearly by the next sub_bits bits, so every value is held to within
+ * 1/sub_count of itself whatever its size, in a fixed array with no
+ * allocation when recording. Values below sub_count are exact.
+ *
+ */
+class LatencyHistogram {
+public:
+	// Bits of each value kept after the highest bit
+	static constexpr int sub_bits=5;
+	// Linear buckets for each power of 2
+	static constexpr uint64_t sub_count=uint64_t(1) << sub_bits;
+	// Buckets to cover all 64 bit values
+	static constexpr std::size_t bucket_count=(64-sub_bits+1)*sub_count;
+
+	/**
+	 * Record a value
+	 * @param nanos the latency
+	 */
+	void record(uint64_t nanos) noexcept {
+		++buckets[bucket(nanos)];
+		++total;
+		if (nanos > max_value) {
+			max_value=nanos;
+		}
+	}
+
+	/**
+	 * Value at a percentile, the highest value of its bucket
+	 * @param percentile 0 to 100
+	 * @return the value or 0 if nothing recorded
+	 */
+	uint64_t value_at(double percentile) const noexcept {
+		if (total==0) {
+			return 0;
+		}
+		uint64_t rank=static_cast<uint64_t>(percentile/100.0*total+0.5);
+		rank=std::max<uint64_t>(rank,1);
+		uint64_t seen=0;
+		for (std::size_t i=0; i < bucket_count; i++) {
+			seen+=buckets[i];
+			if (seen >= rank) {
+				return std::min(highest(i),max_value);
+			}
+		}
+		return max_value;
+	}
+
+	uint64_t count() const noexcept {
+		return total;
+	}
+
+	uint64_t max() const noexcept {
+		return max_value;
+	}
+
+	/**
+	 * Add the values of another histogram, i.e from another thread
+	 * @param other
+	 */
+	LatencyHistogram& operator+=(const LatencyHistogram& other) {
+		for (std::size_t i=0; i < bucket_count; i++) {
+			buckets[i]+=other.buckets[i];
+		}
+		total+=other.total;
+		max_value=std::max(max_value,other.max_value);
+		return *this;
+	}
+
+private:
+	/**
+	 * Bucket of a value
+	 */
+	static std::size_t bucket(uint64_t value) noexcept {
+		if (value < sub_count) {
+			return value;
+		}
+		int shift=63-__builtin_clzll(value)-sub_bits;
+		return shift*sub_count+(value >> shift);
+	}
+
+	/**
+	 * Highest value that falls in a bucket
+	 */
+	static uint64_t highest(std::size_t i) noexcept {
+		if (i < 2*sub_count) {
+			return i;
+		}
+		int shift=i/sub_count-1;
+		return ((i-shift*sub_count+1) << shift)-1;
+	}
+
+	// Count of values in each bucket
+	std::array<uint64_t,bucket_count> buckets{};
+	// Count of all values
+	uint64_t total=0;
+	// Largest value exactly
+	uint64_t max_value=0;
+};
+
+/**
+ * Monotonic clock in nanoseconds for timing
+ * @return now
+ */
+inline uint64_t latency_clock() noexcept {
+	struct timespec ts;
+	::clock_gettime(CLOCK_MONOTONIC, &ts);
+	return uint64_t(ts.tv_sec)*1000000000+ts.tv_nsec;
+}
+
+/**
+ * @brief Latency of the messages processed, by the stage of processing
+ * and by the event of the message
+ *
+ */
+class LatencyStats {
+public:
+	/**
+	 * @brief The stages of processing a message
+	 */
+	enum Stage {
+		Tokenize,
+		Parse,
+		Book,
+		Publish,
+		Stages
+	};
+
+	/**
+	 * Record the times of a message
+	 * @param event of the message
+	 * @param times at the start of the message and the end of each stage
+	 */
+	void record(Event event, const std::array<uint64_t,Stages+1>& times) noexcept {
+		for (int s=Tokenize; s < Stages; s++) {
+			stages[s].record(times[s+1]-times[s]);
+		}
+		events[event_index(event)].record(times[Stages]-times[Tokenize]);
+	}
+
+	/**
+	 * Add the latencies of another, i.e from another thread
+	 * @param other
+	 */
+	LatencyStats& operator+=(const LatencyStats& other) {
+		for (int s=Tokenize; s < Stages; s++) {
+			stages[s]+=other.stages[s];
+		}
+		for (std::size_t e=0; e < events.size(); e++) {
+			events[e]+=other.events[e];
+		}
+		return *this;
+	}
+
+	/**
+	 * Print out the percentiles onto the stream, of each stage, each
+	 * event and, from the histograms of the events merged, all messages
+	 * @param ostr
+	 */
+	void print(std::ostream &ostr) const {
+		static constexpr const char* stage_names[]={"Tokenize","Parse","Book","Publish"};
+		static constexpr const char* event_names[]={"Add","Modify","Cancel","Trade","Snapshot","Other"};
+
+		ostr << "Latency summary (nanos)\n";
+		print_line(ostr,"",nullptr);
+		for (int s=Tokenize; s < Stages; s++) {
+			print_line(ostr,stage_names[s],&stages[s]);
+		}
+		LatencyHistogram all;
+		for (std::size_t e=0; e < events.size(); e++) {
+			if (events[e].count()) {
+				print_line(ostr,event_names[e],&events[e]);
+			}
+			all+=events[e];
+		}
+		print_line(ostr,"All",&all);
+	}
+
+private:
+	/**
+	 * Print the percentiles of one histogram or the heading
+	 */
+	static void print_line(std::ostream &ostr,const char* name,const LatencyHistogram* h) {
+		int buff_len = 120;
+		char buffer[buff_len];
+		if (h==nullptr) {
+			snprintf(buffer,buff_len,"%-10s%10s%10s%10s%10s%10s%10s\n",
+					"","count","p50","p90","p99","p99.9","max");
+		}
+		else {
+			snprintf(buffer,buff_len,"%-10s%10lu%10lu%10lu%10lu%10lu%10lu\n",
+					name,h->count(),h->value_at(50),h->value_at(90),
+					h->value_at(99),h->value_at(99.9),h->max());
+		}
+		ostr << buffer;
+	}
+
+	/**
+	 * Histogram of each event. Event::Mid has the same value as
+	 * Event::Modify, 'M', so a Mid is counted under Modify by its case
+	 * and not under Other
+	 */
+	static std::size_t event_index(Event event) noexcept {
+		static_assert(Event::Mid==Event::Modify,"Mid is counted as Modify");
+		switch (event) {
+		case Event::Add:
+			return 0;
+		case Event::Modify:
+			return 1;
+		case Event::Cancel:
+			return 2;
+		case Event::Trade:
+			return 3;
+		case Event::Snapshot:
+			return 4;
+		default:
+			return 5;
+		}
+	}
+
+	// Latency of each stage
+	std::array<LatencyHistogram,Stages> stages;
+	// Latency of all stages for each event
+	std::array<LatencyHistogram,6> events;
+};
+
+#endif
@@ -7,6 +7,7 @@
 #include <utility>
 #include <vector>
 #include <cstring>
+#include <algorithm>
 
 #include "md_stats.h"
 #include "md_helper.h"
@@ -20,9 +21,6 @@
    */
 template <typename BookContainer=BookMap>
 class OrderBook {
-	typedef std::map<PriceLevelKey,typename BookContainer::Orders,GreaterComp> SortedBids;
-	typedef std::map<PriceLevelKey,typename BookContainer::Orders,LessComp> SortedAsks;
-
 public:
 	/**
 	 *  @brief  Add an order.
@@ -33,20 +31,22 @@ public:
 	 *
 	 *  Monitor the add order to see if it produces trade match
 	 *
+	 *  @return None or NoTradeMatchingOrder, the order is added either way
 	 */
-	void add(Order && order) {
+	MessageError add(Order && order) {
 		// Choose a side
 		if (order.side == Side::Bid) {
 			// Add bid order
-			add_side(order, levels.bidLevels);
+			add_side(order, levels.bidLevels, top_bids);
 			// Monitor this add to see if it may cause a match
-			monitor_bid_order_match(order);
+			return monitor_bid_order_match(order);
 		} else if (order.side == Side::Ask) {
 			// Add ask order
-			add_side(order, levels.askLevels);
+			add_side(order, levels.askLevels, top_asks);
 			// Monitor this add to see if it may cause a match
-			monitor_ask_order_match(order);
+			return monitor_ask_order_match(order);
 		}
+		return MessageError::None;
 	}
 
 	/**
@@ -61,10 +61,10 @@ public:
 		// Choose a side
 		if (order.side == Side::Bid) {
 			// Modify bid order
-			modify_side(order, levels.bidLevels);
+			modify_side(order, levels.bidLevels, top_bids);
 		} else if (order.side == Side::Ask) {
 			// Modify ask order
-			modify_side(order, levels.askLevels);
+			modify_side(order, levels.askLevels, top_asks);
 		}
 	}
 
@@ -80,10 +80,10 @@ public:
 		// Choose a side
 		if (order.side == Side::Bid) {
 			// Cancel bid order
-			cancel_side(order, levels.bidLevels);
+			cancel_side(order, levels.bidLevels, top_bids);
 		}  else if (order.side == Side::Ask) {
 			// Cancel ask order
-			cancel_side(order, levels.askLevels);
+			cancel_side(order, levels.askLevels, top_asks);
 		}
 	}
 
@@ -97,8 +97,9 @@ public:
 	 *  Note: we are no summing at this point as we sum on demand
 	 *  of the trade information in the book @see book_trade().
 	 *
+	 *  @return None or NoOrderMatchingTrade, the trade is taken either way
 	 */
-	void trade(Trade && trade) {
+	MessageError trade(Trade && trade) {
 		if (trade.price != total_traded.price) {
 			// Reset the price
 			total_traded.total.clear();
@@ -110,7 +111,7 @@ public:
 		total_traded.total.push_back(trade.quantity);
 
 		// Check to see if this was expected as part of the match
-		monitor_trade(trade);
+		return monitor_trade(trade);
 	}
 
 	/**
@@ -119,16 +120,25 @@ public:
 	 *
 	 */
 	void snapshot_orders(Orders && orders) {
+		// The depth of the book goes with it
+		stats().orders(-static_cast<int64_t>(order_index.size()));
+		stats().levels(Side::Bid,-static_cast<int64_t>(levels.bidLevels.size()));
+		stats().levels(Side::Ask,-static_cast<int64_t>(levels.askLevels.size()));
 		levels.clear();
+		order_index.clear();
+		top_bids.clear();
+		top_asks.clear();
+		// Every level is new after a snapshot
+		changed_level=0;
 
 		for (auto order: orders) {
 			// Choose a side
 			if (order.side == Side::Bid) {
 				// Add bid order
-				add_side(order, levels.bidLevels);
+				add_side(order, levels.bidLevels, top_bids);
 			} else if (order.side == Side::Ask) {
 				// Add ask order
-				add_side(order, levels.askLevels);
+				add_side(order, levels.askLevels, top_asks);
 			}
 		}
 	}
@@ -156,54 +166,112 @@ public:
 
 
 	/**
-	 *  @brief  Get the top bid from underlying BookContainer book data structure.
+	 *  @brief  Get the top bid from the top levels kept as the book changes,
+	 *  		so the BookContainer is not searched or sorted
 	 *  @return price of top bid
 	 *
 	 */
-	PriceLevelKey get_top_bid() noexcept {
-		return levels.get_top_bid();
+	PriceLevelKey get_top_bid() const noexcept {
+		return top_bids.best();
 	}
 
 	/**
-	 *  @brief  Get the top ask from underlying BookContainer book data structure.
-	 *  @return price of top bid
+	 *  @brief  Get the top ask from the top levels kept as the book changes,
+	 *  		so the BookContainer is not searched or sorted
+	 *  @return price of top ask
 	 *
 	 */
-	PriceLevelKey get_top_ask() noexcept {
-		return levels.get_top_ask();
+	PriceLevelKey get_top_ask() const noexcept {
+		return top_asks.best();
 	}
 
 	/**
-	 *  @brief  Get the mid price from underlying BookContainer book data structure.
+	 *  @brief  Get the mid price from the top levels.
 	 *  @return mid price as a floating point type
 	 *
 	 */
-	PriceType get_mid() noexcept  {
+	PriceType get_mid() const noexcept  {
 		return (get_top_ask() + get_top_bid()) / 2.0;
 	}
 
+	/**
+	 *  @brief  Set the instrument this book is for
+	 *  @param  id instrument id given to all the data published
+	 *
+	 */
+	void set_instrument(InstrumentId id) noexcept {
+		instrument=id;
+	}
+
+	/**
+	 *  @brief  The instrument this book is for
+	 *
+	 */
+	InstrumentId get_instrument() const noexcept {
+		return instrument;
+	}
+
+	/**
+	 *  @brief  Have any of the first n levels changed since @see reset_changed
+	 *  @param  n number of levels of interest, on either side
+	 *  @return True if a change reached the first n levels
+	 *
+	 *  Used to publish only when the book data would be different
+	 *
+	 */
+	bool levels_changed(std::size_t n) const noexcept {
+		return changed_level < n;
+	}
+
+	/**
+	 *  @brief  Start collecting changes again, normally after a publish
+	 *
+	 */
+	void reset_changed() noexcept {
+		changed_level=max_levels;
+	}
+
 private:
+	    /**
+	     *  @brief   Record the first level changed by a TopLevels update
+	     *  @param   level returned by @see TopLevels::update
+	     *
+	     */
+	    void track(std::size_t level) noexcept {
+	    	changed_level=std::min(changed_level,level);
+	    }
+
 	    /**
 	     *  @brief   Add an order for particular side.
 	     *  @tparam  PriceLevels Type of underlying price data
 	     *  @param   o Order object.
 	     *  @param   sideLevels PriceLevels price level for particular side (Bid or Ask)
+	     *  @param   top TopLevels of the same side to apply the change to
 	     *
-	     *  The price level is selected using <levels>[order.price] which can either
-	     *  create or retrieve an existing price level
+	     *  The order id is checked in the order index to make sure there is no
+	     *  duplicate orderid in the price level. If it does we record this as
+	     *  a statistic.
 	     *
-	     *  Next <price level>[order.orderid] is checked to make sure there is no duplicate
-	     *  orderid. If it does we record this as a statistic and throw runtime.
+	     *  The price level is selected using <levels>[order.price] which can either
+	     *  create or retrieve an existing price level and the order is added to
+	     *  it, recording where in the order index.
 	     *
 	     *  The PriceLevel template is part of the underlying BookContainer type template
 	     *  parameter and could be BookContainer::BidPriceLevels or BookContainer::AskPriceLevels
 	     */
-	    template<typename PriceLevels>
-	    void add_side(const Order & order,PriceLevels & sideLevels) {
+	    template<typename PriceLevels, typename Top>
+	    void add_side(const Order & order,PriceLevels & sideLevels,Top & top) {
 	    	// Order id cannot exist yet
-			if (sideLevels[order.price].count(order.orderid)==0) {
+			if (order_index.find(order.orderid,order.side,order.price)==nullptr) {
 				// OK add the order
-				sideLevels[order.price][order.orderid] = order.quantity;
+				auto & level=sideLevels[order.price];
+				if (level.empty()) {
+					stats().levels(order.side,1);
+				}
+				uint32_t position=insert_order(level,order.orderid,order.quantity);
+				order_index.insert({order.orderid,order.price,position,order.side});
+				stats().orders(1);
+				track(top.update(order.price,1,order.quantity,sideLevels));
 			}
 			else {
 				// Already have this order then if must be duplicate
@@ -212,37 +280,56 @@ private:
 	    }
 
 	    /**
-	     *  @brief   Modify an order for particular side.
+	     *  @brief   Find an order for particular side.
 	     *  @tparam  PriceLevels Type of underlying price data
 	     *  @param   o Order object.
 	     *  @param   sideLevels PriceLevels price level for particular side (Bid or Ask)
+	     *  @return  the order location or nullptr if not found
 	     *
-	     *  The price level is selected using <levels>[order.price] which must exist
-	     *  and will record if missing
+	     *  The order must be in the order index at the same side and price.
+	     *  If it is not we record either that the price level is missing or
+	     *  that the order is missing from the level.
+	     */
+	    template<typename PriceLevels>
+	    OrderLocation* find_side(const Order & order,PriceLevels & sideLevels) {
+	    	if (OrderLocation* location=order_index.find(order.orderid,order.side,order.price)) {
+	    		return location;
+	    	}
+
+	    	// Modify or cancel must have a price level
+	    	if (sideLevels.count(order.price)>0) {
+	    		// Order id must exist too, both are
+	    		// recorded with this single statistic
+	    		stats().no_order_for_modify();
+	    	}
+	    	else {
+	    		stats().missing_price_level();
+	    	}
+	    	return nullptr;
+	    }
+
+	    /**
+	     *  @brief   Modify an order for particular side.
+	     *  @tparam  PriceLevels Type of underlying price data
+	     *  @param   o Order object.
+	     *  @param   sideLevels PriceLevels price level for particular side (Bid or Ask)
+	     *  @param   top TopLevels of the same side to apply the change to
 	     *
-	     *  Next <price level>[order.orderid] is checked to make sure it exists for
-	     *  orderid. If it does not we record this as missing and throw runtime.
+	     *  The order is found through the order index @see find_side which
+	     *  records if it is missing.
 	     *
 		 *  The PriceLevel template is part of the underlying BookContainer type template
 	     *  parameter and could be BookContainer::BidPriceLevels or BookContainer::AskPriceLevels
 	     */
-	    template<typename PriceLevels>
-	    void modify_side(const Order & order,PriceLevels & sideLevels) {
-	    	// Price must be here for modify
-			if (sideLevels.count(order.price)>0) {
-				// Order id must exist too
-				if (sideLevels[order.price].count(order.orderid)>0) {
-					// OK we modify
-					sideLevels[order.price][order.orderid] = order.quantity;
-				}
-				else {
-					stats().no_order_for_modify();
-				}
-			}
-			else {
-				// Modify must have a price level
-				stats().missing_price_level();
-			}
+	    template<typename PriceLevels, typename Top>
+	    void modify_side(const Order & order,PriceLevels & sideLevels,Top & top) {
+	    	if (OrderLocation* location=find_side(order,sideLevels)) {
+	    		// OK we modify
+	    		auto & level=sideLevels[order.price];
+	    		int change=static_cast<int>(order.quantity)-static_cast<int>(order_quantity(level,*location));
+	    		change_quantity(level,*location,order.quantity);
+	    		track(top.update(order.price,0,change,sideLevels));
+	    	}
 	    }
 
 	    /**
@@ -250,53 +337,49 @@ private:
 	     *  @tparam  PriceLevels Type of underlying price data
 	     *  @param   o Order object.
 	     *  @param   sideLevels PriceLevels price level for particular side (Bid or Ask)
-	     *	     *
-	     *  Removes the order from the price level.
+	     *  @param   top TopLevels of the same side to apply the change to
+	     *
+	     *  Removes the order from the price level and the order index.
 	     *
 	     *  When the orders are all cancelled at particular level then we remove
 	     *  the price as it has effectively disappeared.
 	     *
-	     *  The price level is selected using <levels>[order.price] which must exist
-	     *  and will record if missing
-	     *
-	     *  Next <price level>[order.orderid] is checked to make sure it exists for
-	     *  orderid. If it does not we record this as missing and throw runtime.
+	     *  The order is found through the order index @see find_side which
+	     *  records if it is missing.
 	     *
 		 *  The PriceLevel template is part of the underlying BookContainer type template
 	     *  parameter and could be BookContainer::BidPriceLevels or BookContainer::AskPriceLevels
 	     */
-	    template<typename PriceLevels>
-	    void cancel_side(const Order & order,PriceLevels & sideLevels) {
-	    	// Price must be here for cancel
-			if (sideLevels.count(order.price)>0) {
-				// Order id must exist too
-				if (sideLevels[order.price].count(order.orderid)>0) {
-					// Only erase completely if quantity is fully taken
-					// I expect any cancel to be a complete cancel not
-					// partial one
-					if (sideLevels[order.price][order.orderid] <= order.quantity) {
-						// Complete cancel
-						(sideLevels[order.price]).erase(order.orderid);
+	    template<typename PriceLevels, typename Top>
+	    void cancel_side(const Order & order,PriceLevels & sideLevels,Top & top) {
+	    	if (OrderLocation* location=find_side(order,sideLevels)) {
+	    		auto & level=sideLevels[order.price];
+	    		auto quantity=order_quantity(level,*location);
+				// Only erase completely if quantity is fully taken
+				// I expect any cancel to be a complete cancel not
+				// partial one
+				if (quantity <= order.quantity) {
+					// Complete cancel, orders that move in the level
+					// have their position updated in the index
+					erase_order(level,*location,[this,&order](const OrderIdKeyType& orderid,uint32_t position) {
+						order_index.find(orderid,order.side,order.price)->position=position;
+					});
+					order_index.erase(order.orderid,order.side,order.price);
+					stats().orders(-1);
+
+					// If Price level has no orders then it disappears
+					if (level.empty()) {
+						sideLevels.erase(order.price);
+						stats().levels(order.side,-1);
 					}
-					else{
-						// Partial cancel
-						sideLevels[order.price][order.orderid] -= order.quantity;
-					}
-				}
-				else {
-					// are recored with this single statistic
-					stats().no_order_for_modify();
+					track(top.update(order.price,-1,-static_cast<int>(quantity),sideLevels));
 				}
-
-				// If Price level has no orders then it disappears
-				if (sideLevels[order.price].empty()) {
-					(sideLevels).erase(order.price);
+				else{
+					// Partial cancel
+					change_quantity(level,*location,quantity-order.quantity);
+					track(top.update(order.price,0,-static_cast<int>(order.quantity),sideLevels));
 				}
-			}
-			else {
-				// Cancel must have a price level
-				stats().missing_price_level();
-			}
+	    	}
 	    }
 
 	    /**
@@ -309,14 +392,16 @@ private:
 	     *  and we should have got a trade(s) to clear this match order but instead
 	     *  we get a order event. So this means we are missing a trade and we record
 	     *  this as an error statistic
+	     *
+	     *  @return None or NoTradeMatchingOrder
 	     */
-	    void monitor_bid_order_match(const Order & order) {
+	    MessageError monitor_bid_order_match(const Order & order) {
 	        if (matchedOrderPendingTrades.price>0) {
 	        	// We should'have a new order we are expecting
 	        	// a trade so flag this as bad
 	            stats().best_ask_le_best_bid();
 	            matchedOrderPendingTrades={};
-	            throw std::runtime_error("No trade matching order");
+	            return MessageError::NoTradeMatchingOrder;
 	        }
 	        // Check if a match is occurring
 	        else if (!levels.bidLevels.empty()) {
@@ -327,6 +412,7 @@ private:
 	                matchedOrderPendingTrades={order.price,order.orderid};
 	            }
 	        }
+	        return MessageError::None;
 	    }
 
 	    /**
@@ -339,14 +425,16 @@ private:
 	     *  and we should have got a trade(s) to clear this match order but instead
 	     *  we get a order event. So this means we are missing a trade and we record
 	     *  this as an error statistic
+	     *
+	     *  @return None or NoTradeMatchingOrder
 	     */
-	    void monitor_ask_order_match(const Order & order) {
+	    MessageError monitor_ask_order_match(const Order & order) {
 	        if (matchedOrderPendingTrades.price>0) {
 	        	// We should'have a new order we are expecting
 	        	// a trade so flag this as bad
 	            stats().best_ask_le_best_bid();
 	            matchedOrderPendingTrades={};
-	            throw std::runtime_error("No trade matching order");
+	            return MessageError::NoTradeMatchingOrder;
 	        }
 	        // Check if a match is occurring
 	        else if (!levels.askLevels.empty()) {
@@ -357,6 +445,7 @@ private:
 	                matchedOrderPendingTrades={order.price,order.orderid};
 	            }
 	        }
+	        return MessageError::None;
 	    }
 
 	    /**
@@ -366,8 +455,9 @@ private:
 	     *
 	     *  If trade matches what we expect then OK clear the pending
 	     *
+	     *  @return None or NoOrderMatchingTrade
 	     */
-	    void monitor_trade(const Trade & t) {
+	    MessageError monitor_trade(const Trade & t) {
 	    	// Did we get a trade which corresponds with pending match
 	    	if (matchedOrderPendingTrades.price > 0.0) {
 	    		// Order pending a trade
@@ -382,9 +472,10 @@ private:
 				else {
 					// Trade does not match the order
 					stats().no_order_for_trade();
-					throw std::runtime_error("No order matching trade");
+					return MessageError::NoOrderMatchingTrade;
 				}
 	    	}
+	    	return MessageError::None;
 	    }
 
 	private:
@@ -396,13 +487,28 @@ private:
 	    //    and requires sequential sum for order quantities
 	    // 3. BookVector implemented with std::vector with more implementation to maintain sort
 	    //    at runtime also make use vector instructions for sum for order quantities
+	    // 4. BookLadder implemented as a flat array indexed by price with the best prices
+	    //    maintained as levels change, the orders at a price are as BookVector
 	    BookContainer levels;
+	    // Where each order is in the levels by order id, so modify
+	    // and cancel do not have to search the price level
+	    OrderIndex order_index;
+	    // The best bid levels aggregated as BookData needs them, kept up
+	    // to date with every change so book_data is just a copy
+	    TopLevels<GreaterComp> top_bids;
+	    // The best ask levels aggregated as BookData needs them
+	    TopLevels<LessComp> top_asks;
+	    // First level on either side changed since reset_changed or
+	    // max_levels if none have
+	    std::size_t changed_level=max_levels;
 	    // The total traded we maintain when monitoring trade event
 	    // The price and vector of all the quantities at this price after reset
 	    TotalTraded total_traded{};
 	    // Monitor the trade that should happen, this is what is pending
 	    // and should happen in next tarde event
 	    PendingMatch matchedOrderPendingTrades{};
+	    // Instrument of this book, 0 when the feed has only one book
+	    InstrumentId instrument{};
 
 	public:
 	    /**
@@ -416,41 +522,30 @@ private:
 	     */
 	    template <int n=5>
 	    BookData<n>  book_data(Event event=Event::Unknown) {
-	    	static_assert(n <= 20,"Order book may not be bigger than 20 levels");
-
-	    	// Sort the bid levels, if they are not sorted already @see sorted_bid
-	        SortedBids &bid_prices=levels.get_sorted_bids();
-	    	auto bid_it = bid_prices.begin();
-	    	auto bid_end = bid_prices.end();
+	        BookData<n> book;
+	        book_data(book,event);
+	    	return book;
+	    }
 
-	    	// Sort the ask levels, if they are not sorted already @see sorted_bid
-	    	SortedAsks &ask_prices=levels.get_sorted_asks();
-	    	auto ask_it = ask_prices.begin();
-	    	auto ask_it_end = ask_prices.end();
+	    /**
+	     *  @brief   Write the book data into place, i.e a slot claimed from a publisher
+	     *  @tparam  n Number of levels for this BookData default to 5
+	     *  @param   book to write, every field is written whatever it held before
+	     *  @param   Optional event if we use this to produce a book on a particular event.
+	     *
+	     */
+	    template <int n=5>
+	    void book_data(BookData<n> & book,Event event=Event::Unknown) {
+	    	static_assert(n <= 20,"Order book may not be bigger than 20 levels");
 
-	        BookData<n> book;
 	        book.event=event;
-	        // Forward iterate cycle
-	        for (int i =0; i < n; i++) {
-	        	// Check that we have that bid level otherwise this level is left default {0}
-	        	if (bid_it != bid_end) {
-	        		typename BookContainer::Orders bidLevel;
-	        		// Expand the bid level into price key and quantities
-	        		std::tie(book.bdprice[i],bidLevel)=*(bid_it++);
-	        		book.bdcontr[i]=bidLevel.size();
-	        		book.bdquantity[i]=sum(bidLevel);
-	        	}
-	        	// Check that we have that ask level otherwise this level is left default {0}
-	        	if (ask_it != ask_it_end) {
-	        		typename BookContainer::Orders askLevel;
-	        		// Expand the bid level into price key and quantities
-	        		std::tie(book.sdprice[i],askLevel)=*(ask_it++);
-	        		book.sdcontr[i]=askLevel.size();
-	        		book.sdquantity[i]=sum(askLevel);
-	        	}
-	        }
-
-	    	return book;
+	        book.instrument=instrument;
+	        // Levels are kept aggregated as they change so only copy
+	        // them, unused levels are held as {0}
+	        top_bids.copy(book.bdcontr,book.bdquantity,book.bdprice);
+	        top_asks.copy(book.sdcontr,book.sdquantity,book.sdprice);
+	        book.last_trade={};
+	        book.total_traded_quantity={};
 	    }
 
 	    /**
@@ -463,16 +558,26 @@ private:
 	     */
 	    template <int n=5>
 	    BookData<n>  trade_data() {
+	        BookData<n> book;
+	        trade_data(book);
+	    	return book;
+	    }
+
+	    /**
+	     *  @brief   Write the book data with the latest trade into place
+	     *  @tparam  n Number of levels for this BookData default to 5
+	     *  @param   book to write, every field is written whatever it held before
+	     *
+	     */
+	    template <int n=5>
+	    void trade_data(BookData<n> & book) {
 	    	static_assert(n <= 20,"Order book may not be bigger than 20 levels");
 
-	        BookData<n> book=book_data();
-	        book.event=Event::Trade;
+	        book_data(book,Event::Trade);
 	        // The last trade and its traded quantity
 	        book.last_trade={total_traded.side,total_traded.total.back(),total_traded.price};
 	        // Sum of all quantities at this price
 	        book.total_traded_quantity={total_traded.side,sum(total_traded.total),total_traded.price};
-
-	    	return book;
 	    }
 
 	    /**
@@ -486,14 +591,26 @@ private:
 	     */
 	    template <int n=5>
 	    BookData<n> mid_data(Event event=Event::Unknown) {
+	        BookData<n> book;
+	        mid_data(book);
+	    	return book;
+	    }
+
+	    /**
+	     *  @brief   Write the mid data top bid/ask into place
+	     *  @tparam  n Number of levels for this BookData default to 5
+	     *  @param   book to write, all but the top prices are cleared
+	     *
+	     */
+	    template <int n=5>
+	    void mid_data(BookData<n> & book) {
 	    	static_assert(n <= 20,"Order book may not be bigger than 20 levels");
 
-	        BookData<n> book;
+	        book=BookData<n>();
 	        book.event=Event::Mid;
-			book.bdprice[0]=levels.get_top_bid();
-			book.sdprice[0]=levels.get_top_ask();
-
-	    	return book;
+	        book.instrument=instrument;
+			book.bdprice[0]=get_top_bid();
+			book.sdprice[0]=get_top_ask();
 	    }
 };
 
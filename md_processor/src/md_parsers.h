@@ -1,2 +1,3 @@
 
 #include "parser/list_parser.h"
+#include "parser/instrument_list_parser.h"
@@ -0,0 +1,178 @@
+#ifndef md_pipelined_handler_h
+#define md_pipelined_handler_h
+
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <disruptor/ring_buffer.h>
+#include <disruptor/event_processor.h>
+#include <disruptor/exception_handler.h>
+
+#include "md_handler.h"
+#include "pipeline/pipeline_event.h"
+
+/**
+   *  @brief Implementation of the md handler as a pipeline of stages
+   *
+   *  The work for a message is split over three threads
+   *
+   *   reader - the adapter thread reads and frames the message
+   *   parse  - tokenizes and parses it into a fixed size record
+   *   book   - applies the record to the order book and publishes
+   *
+   *  so while one message is applied to the book the next is being parsed
+   *  and the one after read.
+   *
+   *  The stages share one disruptor ring buffer, each stage has its own
+   *  sequence and waits on the stage before it, the parse stage on the
+   *  reader cursor and the book stage on the parse stage. The reader is
+   *  gated by the book stage so a message stays in place until the last
+   *  stage is done with it and no copy is made between stages. The stages
+   *  busy spin so each wants a core to itself, --cpus pins them.
+   *
+   *  The same interface as the md_handler is given to the adapters.
+   *
+   *  @tparam TokenContainer tokens for the messages
+   */
+template <typename TokenContainer, typename Parser=list_parser, typename BookContainer=BookMap,typename Publisher=print_publisher<>>
+class pipelined_md_handler {
+public:
+	typedef md_handler<Parser,BookContainer,Publisher> Handler;
+
+	/**
+	 * Create the stages, nothing runs until start
+	 * @param cpus for the reader, parse and book stages in that order,
+	 *        any not given or negative are not pinned
+	 */
+	explicit pipelined_md_handler(const std::vector<int>& cpus) :
+		cpus(cpus),
+		ring_buffer(&factory, pipeline_buffer_size,
+				kSingleThreadedStrategy, kBusySpinStrategy),
+		parse_barrier(ring_buffer.NewBarrier(std::vector<Sequence*>{})),
+		parse_processor(&ring_buffer,
+				(SequenceBarrierInterface*)parse_barrier.get(),
+				&parse_handler,
+				&exception_handler),
+		book_barrier(ring_buffer.NewBarrier({parse_processor.GetSequence()})),
+		book_handler(md),
+		book_processor(&ring_buffer,
+				(SequenceBarrierInterface*)book_barrier.get(),
+				&book_handler,
+				&exception_handler) {
+		// The reader must not wrap round on messages the
+		// book stage has not applied yet
+		ring_buffer.set_gating_sequences({book_processor.GetSequence()});
+	}
+
+	void start(PrintType printType, const arguments& args) {
+		md.start(printType,args);
+		parse_thread=std::thread(std::ref(parse_processor));
+		book_thread=std::thread(std::ref(book_processor));
+		pin_thread(::pthread_self(), cpu(0));
+		pin_thread(parse_thread.native_handle(), cpu(1));
+		pin_thread(book_thread.native_handle(), cpu(2));
+	}
+
+	/**
+	 * Wait for the stages to finish their messages and stop them
+	 */
+	void stop() {
+		finish();
+		parse_processor.Halt();
+		book_processor.Halt();
+		parse_thread.join();
+		book_thread.join();
+		md.stop();
+	}
+
+	/**
+	 * Wait until the book stage has applied all the messages given
+	 */
+	void finish() {
+		while (book_processor.GetSequence()->sequence() < ring_buffer.GetCursor()) {
+			std::this_thread::yield();
+		}
+	}
+
+	/**
+	 * Put a message into the pipeline
+	 *
+	 * @param line the message
+	 * @param line_number of the message in the input
+	 */
+	template <typename Container, typename Line>
+	void process_line(const Line & line, int line_number) {
+		int64_t sequence=ring_buffer.Next();
+		ring_buffer.Get(sequence)->set(std::string_view(line),line_number);
+		ring_buffer.Publish(sequence);
+	}
+
+	/**
+	 * Put a batch of messages into the pipeline, the book stage
+	 * publishes every message so publish_each is ignored
+	 *
+	 * @param lines the messages of the batch
+	 * @param n number of messages
+	 * @param line_number of the first message in the input
+	 * @param publish_each not used
+	 * @param on_error not used, the stages report failures
+	 */
+	template <typename Container, typename Line, typename OnError>
+	void process_lines(const Line* lines, std::size_t n, int line_number, bool publish_each, OnError on_error) {
+		for (std::size_t i=0; i < n; i++) {
+			process_line<Container>(lines[i], line_number+i);
+		}
+	}
+
+    /**
+     * Prints the stats onto the stream given, those of
+     * all the stages added up
+     * @param ostr output stream
+     */
+    void printStats(std::ostream &ostr) {
+        total_stats().print(ostr);
+    }
+
+private:
+	/**
+	 * The cpu for a stage or -1 if not given
+	 */
+	int cpu(std::size_t stage) const {
+		return stage < cpus.size() ? cpus[stage] : -1;
+	}
+
+	// Ring buffer size of the pipeline
+	static constexpr int pipeline_buffer_size=1<<16;
+
+	// The cpus of the reader, parse and book stages
+	std::vector<int> cpus;
+	// The md handler with the books
+	Handler md;
+	// The events produced for the ring buffer
+	PipelineEventFactory factory;
+	// Messages moving through the stages
+	RingBuffer<PipelineEvent> ring_buffer;
+	// Parse stage waits on the reader
+	std::unique_ptr<ProcessingSequenceBarrier> parse_barrier;
+	// Parses the messages
+	ParseStageHandler<TokenContainer,Handler> parse_handler;
+	// Exception handling, the handlers report their own
+	IgnoreExceptionHandler<PipelineEvent> exception_handler;
+	// Processor of the parse stage
+	BatchEventProcessor<PipelineEvent> parse_processor;
+	// Book stage waits on the parse stage
+	std::unique_ptr<ProcessingSequenceBarrier> book_barrier;
+	// Applies the messages to the books
+	BookStageHandler<Handler> book_handler;
+	// Processor of the book stage
+	BatchEventProcessor<PipelineEvent> book_processor;
+	// The thread of the parse stage
+	std::thread parse_thread;
+	// The thread of the book stage
+	std::thread book_thread;
+};
+
+#endif
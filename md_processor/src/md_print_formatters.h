@@ -49,6 +49,34 @@ static constexpr const unsigned int csv_trade_len=22;
 static constexpr const char* csv_mid_format={"%.2f,%.2f,%.2f\n"};
 static constexpr const unsigned int csv_mid_format_len=40;
 
+/**
+ * Prints the instrument in readable text format ahead of the
+ * book, trade or mid. Nothing for a feed without instruments
+ *
+ * @param ostr
+ * @param book
+ */
+template <int n=5>
+void print_instrument_txt(std::ostream & ostr,const BookData<n> & book) {
+	if (book.instrument) {
+		ostr << "Instrument:" << book.instrument << "\n";
+	}
+}
+
+/**
+ * Prints the instrument as the first csv field. Nothing for a
+ * feed without instruments
+ *
+ * @param ostr
+ * @param book
+ */
+template <int n=5>
+void print_instrument_csv(std::ostream & ostr,const BookData<n> & book) {
+	if (book.instrument) {
+		ostr << book.instrument << ",";
+	}
+}
+
 /**
  * Prints the book in readable text format
  * @param ostr
@@ -75,6 +103,7 @@ void print_book_base(std::ostream & ostr,BookData<n> && book) {
  */
 template <int n=5>
 void print_book_txt(std::ostream & ostr,BookData<n> && book) {
+	print_instrument_txt(ostr,book);
 	ostr << readable_trading_header;
 	print_book_base(ostr,std::forward<BookData<n>>(book));
 	ostr << readable_trailer;
@@ -87,6 +116,7 @@ void print_book_txt(std::ostream & ostr,BookData<n> && book) {
  */
 template <int n=5>
 void print_book_betting(std::ostream & ostr,BookData<n> && book) {
+	print_instrument_txt(ostr,book);
 	ostr << readable_betting_header;
 	print_book_base(ostr,std::forward<BookData<n>>(book));
 	ostr << readable_trailer;
@@ -121,6 +151,7 @@ void print_book_csv_base(std::ostream & ostr,BookData<n> && book) {
  */
 template <int n=5>
 void print_book_csv(std::ostream & ostr,BookData<n> && book) {
+	print_instrument_csv(ostr,book);
 	ostr << "S,U,0,0,";
 	print_book_csv_base(ostr,std::forward<BookData<n>>(book));
 }
@@ -141,6 +172,7 @@ void print_trade_txt(std::ostream & ostr,BookData<n> && book) {
 			book.total_traded_quantity.quantity,book.total_traded_quantity.price,
 			(char)book.last_trade.side,book.last_trade.quantity,book.last_trade.price);
 
+	print_instrument_txt(ostr,book);
 	ostr << buffer;
 }
 
@@ -169,6 +201,7 @@ void print_trade_csv(std::ostream & ostr,BookData<n> && book) {
 	::snprintf(buffer,buff_len,csv_trade_format,
 			(char)book.last_trade.side,book.last_trade.quantity,book.last_trade.price);
 
+	print_instrument_csv(ostr,book);
 	ostr << buffer;
 	print_book_csv_base(ostr,std::forward<BookData<n>>(book));
 }
@@ -191,6 +224,7 @@ void print_mid_txt(std::ostream & ostr,BookData<n> && book) {
 	::snprintf(buffer,buff_len,readable_trading_mid_format,
 			book.bdprice[0],book.sdprice[0],mid);
 
+	print_instrument_txt(ostr,book);
 	ostr << buffer;
 }
 
@@ -212,6 +246,7 @@ void print_mid_betting(std::ostream & ostr,BookData<n> && book) {
 	::snprintf(buffer,buff_len,readable_betting_mid_format,
 			book.bdprice[0],book.sdprice[0],mid);
 
+	print_instrument_txt(ostr,book);
 	ostr << buffer;
 }
 
@@ -0,0 +1,192 @@
+#ifndef md_sharded_handler_h
+#define md_sharded_handler_h
+
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <disruptor/ring_buffer.h>
+#include <disruptor/event_processor.h>
+#include <disruptor/exception_handler.h>
+
+#include "md_handler.h"
+#include "shard/message_event.h"
+
+/**
+   *  @brief Implementation of the md handler split over shards
+   *
+   *  Each shard is a thread with its own md_handler, so its own order books,
+   *  publisher and stats. The adapter thread only decodes the instrument of
+   *  a message and puts the message on the ring buffer of the shard that
+   *  owns the instrument, the shard does the rest. Every instrument is
+   *  always in the same shard and each ring buffer has one producer and one
+   *  consumer so the messages of an instrument are processed in order.
+   *
+   *  The ring buffers are the bundled disruptor so the adapter and a shard
+   *  share no more than the sequences. Shards yield when there is nothing
+   *  to do rather than spin, there may be more shards than cores.
+   *
+   *  The same interface as the md_handler is given to the adapters.
+   *
+   *  @tparam TokenContainer tokens for the messages
+   *  @tparam Parser must be a parser with an instrument i.e instrument_list_parser
+   */
+template <typename TokenContainer, typename Parser=instrument_list_parser, typename BookContainer=BookMap,typename Publisher=print_publisher<>>
+class sharded_md_handler {
+public:
+	typedef md_handler<Parser,BookContainer,Publisher> Handler;
+
+	/**
+	 * Create the shards, nothing runs until start
+	 * @param count number of shards
+	 */
+	explicit sharded_md_handler(std::size_t count) {
+		for (std::size_t i=0; i < count; i++) {
+			shards.emplace_back(std::make_unique<Shard>());
+		}
+	}
+
+	/**
+	 * Start the md handler and thread of each shard, the handler of a
+	 * shard is given --shard=<index> so its consumers can tell it apart
+	 */
+	void start(PrintType printType, const arguments& args) {
+		for (std::size_t i=0; i < shards.size(); i++) {
+			arguments shard_args(args);
+			shard_args.set_opt("shard",std::to_string(i));
+			shards[i]->md.start(printType,shard_args);
+			shards[i]->thread=std::thread(std::ref(shards[i]->processor));
+		}
+	}
+
+	/**
+	 * Wait for the shards to finish their messages and stop them
+	 */
+	void stop() {
+		finish();
+		for (auto & shard : shards) {
+			shard->processor.Halt();
+			shard->thread.join();
+			shard->md.stop();
+		}
+	}
+
+	/**
+	 * Wait until the shards have processed all the messages given
+	 */
+	void finish() {
+		for (auto & shard : shards) {
+			while (shard->processor.GetSequence()->sequence() < shard->ring_buffer.GetCursor()) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	/**
+	 * Route a message to the shard of its instrument, a message
+	 * without a good instrument goes to the error log
+	 *
+	 * @param line the message
+	 * @param line_number of the message in the input
+	 */
+	template <typename Container, typename Line>
+	void process_line(const Line & line, int line_number) {
+		std::string_view message(line);
+		InstrumentId instrument{};
+		FieldResult result=message_key<TokenContainer>(message,instrument,max_instrument_id);
+		if (unlikely(result!=FieldResult::Ok)) {
+			// Never reaches a shard to be counted there
+			stats().message();
+			stats().corrupt_error();
+			report_message_error(result==FieldResult::Range ?
+					MessageError::InstrumentRange : MessageError::InstrumentSyntax, message, line_number);
+			return;
+		}
+
+		Shard & shard=*shards[instrument % shards.size()];
+		int64_t sequence=shard.ring_buffer.Next();
+		shard.ring_buffer.Get(sequence)->set(message,line_number);
+		shard.ring_buffer.Publish(sequence);
+	}
+
+	/**
+	 * Route a batch of messages, each shard processes its messages
+	 * one at a time so publish_each is ignored
+	 *
+	 * @param lines the messages of the batch
+	 * @param n number of messages
+	 * @param line_number of the first message in the input
+	 * @param publish_each not used
+	 * @param on_error not used, process_line and the shards report failures
+	 */
+	template <typename Container, typename Line, typename OnError>
+	void process_lines(const Line* lines, std::size_t n, int line_number, bool publish_each, OnError on_error) {
+		for (std::size_t i=0; i < n; i++) {
+			process_line<Container>(lines[i], line_number+i);
+		}
+	}
+
+    /**
+     * Prints the stats onto the stream given, those of all the shards
+     * added up, and the latency of all the shards
+     * @param ostr output stream
+     */
+    void printStats(std::ostream &ostr) {
+        total_stats().print(ostr);
+        if (shards.front()->md.latency_stats()) {
+        	LatencyStats latency;
+        	for (auto & shard : shards) {
+        		latency+=*shard->md.latency_stats();
+        	}
+        	latency.print(ostr);
+        }
+    }
+
+private:
+	// Ring buffer size of each shard
+	static constexpr int shard_buffer_size=1<<16;
+
+	/**
+	 * @brief A shard is a ring buffer of messages and the thread
+	 * processing them with its own md handler
+	 */
+	struct Shard {
+		Shard() :
+			ring_buffer(&factory, shard_buffer_size,
+					kSingleThreadedStrategy, kYieldingStrategy),
+			barrier(ring_buffer.NewBarrier(std::vector<Sequence*>{})),
+			handler(md),
+			processor(&ring_buffer,
+					(SequenceBarrierInterface*)barrier.get(),
+					&handler,
+					&exception_handler) {
+			// The adapter must not wrap round on messages the
+			// shard has not processed yet
+			ring_buffer.set_gating_sequences({processor.GetSequence()});
+		}
+
+		// The md handler with the books of this shard
+		Handler md;
+		// The events produced for the ring buffer
+		MessageEventFactory factory;
+		// Messages from the adapter
+		RingBuffer<MessageEvent> ring_buffer;
+		// producer/consumer sequence barrier
+		std::unique_ptr<ProcessingSequenceBarrier> barrier;
+		// Processes the messages with md
+		MessageEventHandler<TokenContainer,Handler> handler;
+		// Exception handling, the handler reports its own
+		IgnoreExceptionHandler<MessageEvent> exception_handler;
+		// Processor which gathers batches of messages put on ring buffer
+		BatchEventProcessor<MessageEvent> processor;
+		// The thread of the shard
+		std::thread thread;
+	};
+
+	// The shards
+	std::vector<std::unique_ptr<Shard>> shards;
+};
+
+#endif
@@ -2,121 +2,267 @@
 #define order_book_stats_h
 
 #include <stdint.h>
+#include <array>
+#include <atomic>
 #include <cstdio>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "disruptor/interface.h"
+#include "disruptor/sequence.h"
+
 #include "md_types.h"
 
 /**
  * @brief This is the statistics object which maintains a count of any
- * errors that are propagated in the md
+ * errors that are propagated in the md, of the messages processed and
+ * of the depth of the books, the orders and price levels resting.
+ *
+ * There is one for each thread processing messages @see stats() and
+ * only that thread changes it, so a count is a relaxed load and store
+ * with no locked instruction. Each is on cache lines of its own so the
+ * threads do not share lines, and other threads can read the counts
+ * while they change, the totals are added up on read @see total_stats()
  */
-class OrderBookStats {
+class alignas(CACHE_LINE_SIZE_IN_BYTES) OrderBookStats {
 public:
+	/**
+	 * The counts kept
+	 */
+	enum Counter {
+		Corrupt,
+		EventError,
+		DupOrderid,
+		NoOrderForTrade,
+		NoOrderForModify,
+		BestAskLeBestBid,
+		OrderRange,
+		OrderParse,
+		SideError,
+		QuantityRange,
+		QuantityParse,
+		PriceRange,
+		PriceParse,
+		MissingPriceLevel,
+		// The errors are those before this
+		Messages,
+		Orders,
+		BidLevels,
+		AskLevels,
+		CounterCount
+	};
+
 	OrderBookStats() = default;
 
+	OrderBookStats(const OrderBookStats& other) {
+		*this+=other;
+	}
+
 	void event_error() {
-		++event_error_cnt;
+		add(EventError);
 	}
 
 	void corrupt_error() {
-		++corrupt_cnt;
+		add(Corrupt);
 	}
 	void dup_orderid() {
-		++dup_orderid_cnt;
+		add(DupOrderid);
 	}
 	void no_order_for_trade() {
-		++no_order_for_trade_cnt;
+		add(NoOrderForTrade);
 	}
 	void order_range() {
-		++order_range_cnt;
+		add(OrderRange);
 	}
 	void order_parse() {
-		++order_parse_cnt;
+		add(OrderParse);
 	}
 	void side_error() {
-		++side_error_cnt;
+		add(SideError);
 	}
 	void quantity_range()  {
-		++quantity_range_cnt;
+		add(QuantityRange);
 	}
 	void quantity_parse() {
-		++quantity_parse_cnt;
+		add(QuantityParse);
 	}
 	void price_range()  {
-		++price_range_cnt;
+		add(PriceRange);
 	}
 	void price_parse() {
-		++price_parse_cnt;
+		add(PriceParse);
 	}
 	void no_order_for_modify() {
-		++no_order_for_mod_cnt;
+		add(NoOrderForModify);
 	}
 	void missing_price_level() {
-		++missing_price_level_cnt;
+		add(MissingPriceLevel);
 	}
 	void best_ask_le_best_bid() {
-		++best_ask_le_best_bid_cnt;
+		add(BestAskLeBestBid);
+	}
+
+	/**
+	 * A message has been taken for processing
+	 */
+	void message() {
+		add(Messages);
+	}
+
+	/**
+	 * An order has been added to or taken out of a book
+	 * @param change +1 or -1
+	 */
+	void orders(int64_t change) {
+		add(Orders,change);
+	}
+
+	/**
+	 * A price level has been added to or taken out of a side of a book
+	 * @param side
+	 * @param change +1 or -1
+	 */
+	void levels(Side side, int64_t change) {
+		add(side==Side::Bid ? BidLevels : AskLevels,change);
+	}
+
+	/**
+	 * A count as it is now
+	 * @param counter
+	 */
+	int64_t count(Counter counter) const {
+		return counts[counter].load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * All the errors counted
+	 */
+	int64_t errors() const {
+		int64_t total=0;
+		for (int counter=0; counter < Messages; counter++) {
+			total+=count(static_cast<Counter>(counter));
+		}
+		return total;
+	}
+
+	/**
+	 * Add the counts of another stats, i.e those of a worker thread
+	 * @param other
+	 */
+	OrderBookStats& operator+=(const OrderBookStats& other) {
+		for (int counter=0; counter < CounterCount; counter++) {
+			add(static_cast<Counter>(counter),other.count(static_cast<Counter>(counter)));
+		}
+		return *this;
 	}
 
 	/**
 	 * Print out the stat onto the stream
 	 * @param ostr
 	 */
-	void print(std::ostream &ostr) {
+	void print(std::ostream &ostr) const {
 
 		int buff_len = 300;
 		char buffer[buff_len];
 		int cx;
 		cx = snprintf(buffer, buff_len,
-				"Error summary\nCorrupt event:%3d\nDuplicate order id:%3d\n", corrupt_cnt+event_error_cnt,
-				dup_orderid_cnt);
+				"Error summary\nCorrupt event:%3d\nDuplicate order id:%3d\n", print_count(Corrupt)+print_count(EventError),
+				print_count(DupOrderid));
 		cx += snprintf(buffer + cx, buff_len - cx,
 				"No order matching trade:%3d\nNo order id with cancel or modify:%3d\n",
-				best_ask_le_best_bid_cnt, no_order_for_mod_cnt);
+				print_count(BestAskLeBestBid), print_count(NoOrderForModify));
 		cx += snprintf(buffer + cx, buff_len - cx,
 				"No matching trade with order:%3d\nOrder range:%3d\nOrder syntax:%3d\n",
-				no_order_for_trade_cnt, order_range_cnt,order_parse_cnt);
+				print_count(NoOrderForTrade), print_count(OrderRange),print_count(OrderParse));
 		cx += snprintf(buffer + cx, buff_len - cx,
 				"Side error:%3d\n",
-				side_error_cnt);
+				print_count(SideError));
 		cx += snprintf(buffer + cx, buff_len - cx,
 				"Quantity range:%3d\nQuantity syntax:%3d\n",
-				quantity_range_cnt,quantity_parse_cnt);
+				print_count(QuantityRange),print_count(QuantityParse));
 		cx += snprintf(buffer + cx, buff_len - cx,
 				"Price range:%3d\nPrice syntax:%3d\n",
-				price_range_cnt,price_parse_cnt);
+				print_count(PriceRange),print_count(PriceParse));
 
 		ostr << buffer;
 	}
 
 private:
-	uint32_t corrupt_cnt = 0;
-	uint32_t event_error_cnt = 0;
-	uint32_t dup_orderid_cnt = 0;
-	uint32_t no_order_for_trade_cnt = 0;
-	uint32_t no_order_for_mod_cnt = 0;
-	uint32_t best_ask_le_best_bid_cnt = 0;
-	uint32_t order_range_cnt = 0;
-	uint32_t order_parse_cnt = 0;
-	uint32_t side_error_cnt = 0;
-	uint32_t quantity_range_cnt = 0;
-	uint32_t quantity_parse_cnt = 0;
-	uint32_t price_range_cnt = 0;
-	uint32_t price_parse_cnt = 0;
-	uint32_t missing_price_level_cnt = 0;
+	/**
+	 * Change a count, only ever from the thread that owns the stats
+	 */
+	void add(Counter counter, int64_t change=1) {
+		counts[counter].store(counts[counter].load(std::memory_order_relaxed)+change,std::memory_order_relaxed);
+	}
+
+	int print_count(Counter counter) const {
+		return static_cast<int>(count(counter));
+	}
+
+	std::array<std::atomic<int64_t>,CounterCount> counts{};
+};
+
+/**
+ * @brief The stats of every thread that has counted anything, kept
+ * until the end of the process so the counts of a thread that has
+ * finished are still in the totals
+ */
+class StatsRegistry {
+public:
+	/**
+	 * New stats for a thread
+	 */
+	OrderBookStats& add() {
+		std::lock_guard<std::mutex> lock(mutex);
+		all.emplace_back(std::make_unique<OrderBookStats>());
+		return *all.back();
+	}
+
+	/**
+	 * The counts of all the threads added up
+	 */
+	OrderBookStats total() {
+		std::lock_guard<std::mutex> lock(mutex);
+		OrderBookStats sum;
+		for (auto & stats : all) {
+			sum+=*stats;
+		}
+		return sum;
+	}
+
+private:
+	std::mutex mutex;
+	std::vector<std::unique_ptr<OrderBookStats>> all;
 };
 
+inline StatsRegistry& stats_registry() {
+	static StatsRegistry registry;
+	return registry;
+}
+
 /**
- * Singleton to the statistics for the book
- * c++11 makes this safe to initialise
+ * The statistics of the calling thread, one for each thread so threads
+ * processing their own books do not share the counts or the cache lines.
+ * The stats of a thread are made the first time it counts something
  * @return the book stats
  */
 static OrderBookStats& stats(){
-  static OrderBookStats instance;
-  return instance;
+  static thread_local OrderBookStats* instance=nullptr;
+  if (unlikely(instance==nullptr)) {
+	  instance=&stats_registry().add();
+  }
+  return *instance;
+}
+
+/**
+ * The stats of all the threads added up, can be taken at any time
+ * @return the totals
+ */
+inline OrderBookStats total_stats() {
+	return stats_registry().total();
 }
 
 #endif
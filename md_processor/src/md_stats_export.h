@@ -0,0 +1,140 @@
+#ifndef md_stats_export_h
+#define md_stats_export_h
+
+#include <stdint.h>
+#include <time.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "arguments.h"
+#include "md_stats.h"
+
+/**
+   *  @brief Writes the stats of a running processor to a snapshot file
+   *  every interval, so it can be watched without stopping it
+   *
+   *  Given --stats_file=FILE, every --stats_interval milliseconds (1000 by
+   *  default) the stats of all the threads are added up and written as one
+   *  line of json with the message and error rates over the interval, the
+   *  depth of the books, the orders and price levels resting in all of
+   *  them, and each error count. The snapshot is written to FILE.tmp and
+   *  renamed so a reader never sees half of one. A last snapshot is
+   *  written when stopped.
+   *
+   *    watch -n1 cat stats.json
+   *
+   *  The counts are only read, the threads processing messages are not
+   *  held up at all.
+   *
+   */
+class StatsExporter {
+public:
+	explicit StatsExporter(const arguments& args) :
+		path(args.get_opt<std::string>("stats_file", optional_arg, has_arg, "")),
+		interval(args.get_opt<std::size_t>("stats_interval", optional_arg, has_arg, 1000)) {
+		if (not path.empty()) {
+			started=last_time=std::chrono::steady_clock::now();
+			thread=std::thread([this] { run(); });
+		}
+	}
+
+	~StatsExporter() {
+		stop();
+	}
+
+	StatsExporter(const StatsExporter&) = delete;
+	StatsExporter& operator=(const StatsExporter&) = delete;
+
+	/**
+	 * Stop exporting and write the last snapshot
+	 */
+	void stop() {
+		if (not thread.joinable()) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopped=true;
+		}
+		wake.notify_one();
+		thread.join();
+		write();
+	}
+
+private:
+	/**
+	 * The export thread, a snapshot every interval until stopped
+	 */
+	void run() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (not wake.wait_for(lock,interval,[this] { return stopped; })) {
+			write();
+		}
+	}
+
+	/**
+	 * Write a snapshot of the stats now
+	 */
+	void write() {
+		OrderBookStats now=total_stats();
+		auto time=std::chrono::steady_clock::now();
+		double seconds=std::chrono::duration<double>(time-last_time).count();
+		double uptime=std::chrono::duration<double>(time-started).count();
+		int64_t messages=now.count(OrderBookStats::Messages);
+		int64_t errors=now.errors();
+
+		char buffer[1024];
+		int cx=snprintf(buffer,sizeof(buffer),
+				"{\"time\":%ld,\"uptime\":%.3f,\"messages\":%ld,\"messages_per_sec\":%.1f,\"errors\":%ld,\"errors_per_sec\":%.1f,"
+				"\"orders\":%ld,\"bid_levels\":%ld,\"ask_levels\":%ld,",
+				static_cast<long>(::time(nullptr)),uptime,
+				messages,seconds > 0 ? (messages-last_messages)/seconds : 0.0,
+				errors,seconds > 0 ? (errors-last_errors)/seconds : 0.0,
+				now.count(OrderBookStats::Orders),now.count(OrderBookStats::BidLevels),now.count(OrderBookStats::AskLevels));
+		cx+=snprintf(buffer+cx,sizeof(buffer)-cx,
+				"\"corrupt\":%ld,\"duplicate_order_id\":%ld,\"no_order_matching_trade\":%ld,\"no_order_for_modify\":%ld,"
+				"\"no_matching_trade_with_order\":%ld,\"order_range\":%ld,\"order_syntax\":%ld,\"side_error\":%ld,",
+				now.count(OrderBookStats::Corrupt)+now.count(OrderBookStats::EventError),now.count(OrderBookStats::DupOrderid),
+				now.count(OrderBookStats::BestAskLeBestBid),now.count(OrderBookStats::NoOrderForModify),
+				now.count(OrderBookStats::NoOrderForTrade),now.count(OrderBookStats::OrderRange),
+				now.count(OrderBookStats::OrderParse),now.count(OrderBookStats::SideError));
+		snprintf(buffer+cx,sizeof(buffer)-cx,
+				"\"quantity_range\":%ld,\"quantity_syntax\":%ld,\"price_range\":%ld,\"price_syntax\":%ld,\"missing_price_level\":%ld}\n",
+				now.count(OrderBookStats::QuantityRange),now.count(OrderBookStats::QuantityParse),
+				now.count(OrderBookStats::PriceRange),now.count(OrderBookStats::PriceParse),
+				now.count(OrderBookStats::MissingPriceLevel));
+
+		std::string partial=path+".tmp";
+		if (FILE* file=::fopen(partial.c_str(),"w")) {
+			::fputs(buffer,file);
+			::fclose(file);
+			::rename(partial.c_str(),path.c_str());
+		}
+
+		last_time=time;
+		last_messages=messages;
+		last_errors=errors;
+	}
+
+	// The snapshot file, nothing is exported without one
+	std::string path;
+	// Time between snapshots
+	std::chrono::milliseconds interval;
+	// When the export started and the time and counts of the last snapshot
+	std::chrono::steady_clock::time_point started;
+	std::chrono::steady_clock::time_point last_time;
+	int64_t last_messages=0;
+	int64_t last_errors=0;
+	// Wakes the export thread to stop
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopped=false;
+	// Writes the snapshots
+	std::thread thread;
+};
+
+#endif
@@ -5,5 +5,65 @@
 #include "tokenizer/token_containers.h"
 #include "tokenizer/token_json_types.h"
 #include "tokenizer/token_string_types.h"
+#include "tokenizer/token_binary_types.h"
+
+/**
+ * Parse an unsigned field which must be in the range 1 to max
+ *
+ * This is the default for the token containers which parse and then
+ * check the range. char_token_vector has its own which does both in
+ * one pass over the characters.
+ *
+ * @param itr
+ * @param end
+ * @param result
+ * @param max highest value allowed
+ * @return Ok, Syntax if not a number or Range if outside 1 to max
+ */
+template <typename Iterator, typename T>
+inline FieldResult make_bounded(Iterator & itr, const Iterator & end, T &result, const T max) {
+	if (!make_type(itr,end,result)) {
+		return FieldResult::Syntax;
+	}
+	return (result > 0 && result <= max) ? FieldResult::Ok : FieldResult::Range;
+}
+
+/**
+ * Parse only the first field of a message as an unsigned key in the range
+ * 1 to max, without tokenizing the rest of the message. Used to route a
+ * message before it is processed.
+ *
+ * For text formats the field is the characters up to the first delimiter,
+ * a json array start and quotes are skipped. For binary it is the first
+ * word after the header.
+ *
+ * @param message the whole message
+ * @param key the key if Ok
+ * @param max highest value allowed
+ * @return Ok, Syntax if not a number or Range if outside 1 to max
+ */
+template <typename TokenContainer>
+inline FieldResult message_key(std::string_view message, uint32_t &key, const uint32_t max) {
+	if constexpr (std::is_same<TokenContainer,binary_token_vector>::value) {
+		uint32_t field;
+		if (message.size() < sizeof(binary_header)+sizeof(field)) {
+			return FieldResult::Syntax;
+		}
+		std::memcpy(&field,message.data()+sizeof(binary_header),sizeof(field));
+		key=le32toh(field);
+		if (key==binary_invalid_field) {
+			return FieldResult::Syntax;
+		}
+		return (key > 0 && key <= max) ? FieldResult::Ok : FieldResult::Range;
+	}
+	else {
+		std::size_t first=message.find_first_not_of("[ \"");
+		if (first==std::string_view::npos) {
+			return FieldResult::Syntax;
+		}
+		std::size_t last=message.find_first_of(",]\" ",first);
+		return parse_unsigned(message.substr(first,last==std::string_view::npos ? last : last-first),key,max);
+	}
+}
 
 #endif
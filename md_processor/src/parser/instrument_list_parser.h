@@ -0,0 +1,43 @@
+#ifndef instrument_list_parser_h
+#define instrument_list_parser_h
+
+#include "parser/list_parser.h"
+
+/**
+ * @brief Instrument list parser is the list parser for a feed of many instruments
+ * where every message starts with the instrument id the message is for and
+ * is then the same as for the list parser.
+ * So an example is a csv format 17,A,1000001,B,5,900 or [17,"A",1000001,"B",5,900]
+ *
+ * Instrument ids are 1 to max_instrument_id, 0 is kept for the single book
+ * of a feed without instruments
+ *
+ */
+struct instrument_list_parser : public list_parser {
+
+/**
+ * Extracts the instrument id which is the first token of the message
+ * and moves on to the event
+ *
+ * @param message_iter
+ * @param instrument the instrument id
+ * @return None if syntax OK
+ */
+template <typename Iterator>
+static MessageError get_instrument(Iterator &message_iter, const Iterator &end, InstrumentId & instrument) {
+	instrument=InstrumentId{};
+	FieldResult result=parse_bounded(message_iter,end,instrument,max_instrument_id);
+	if (unlikely(result!=FieldResult::Ok)) {
+		stats().corrupt_error();
+		if (result==FieldResult::Range) {
+			return MessageError::InstrumentRange;
+		}
+		return MessageError::InstrumentSyntax;
+	}
+	++message_iter;
+	return MessageError::None;
+}
+
+};
+
+#endif
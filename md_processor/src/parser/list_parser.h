@@ -1,3 +1,6 @@
+#ifndef list_parser_h
+#define list_parser_h
+
 
 #include <stdint.h>
 #include <sys/time.h>
@@ -86,122 +89,153 @@ static bool parse_type(Iterator& message_iter,const Iterator& end,
 	return make_type(message_iter,end,t);
 }
 
+/**
+ * Parse an unsigned field that must be in the range 1 to max
+ *
+ * @param itr
+ * @param t
+ * @param max highest value allowed
+ * @return Ok, Syntax or Range
+ */
+template <typename T, typename Iterator>
+static FieldResult parse_bounded(Iterator& message_iter,const Iterator& end,
+                  T& t, const T max)
+{
+	return make_bounded(message_iter,end,t,max);
+}
+
+/**
+ * There is no instrument in the message, everything is for the
+ * one book of the feed
+ *
+ * @param message_iter
+ * @param instrument set to 0
+ * @return None
+ */
+template <typename Iterator>
+static MessageError get_instrument(Iterator &message_iter, const Iterator &end, InstrumentId & instrument) {
+	instrument=InstrumentId{};
+	return MessageError::None;
+}
+
 /**
  * Extracts the event type from the token list message event
  * @param message_iter
- * @return True if syntax OK
+ * @param event the event of the message
+ * @return None if syntax OK
  */
 template <typename Iterator>
-static auto get_event(Iterator &message_iter, const Iterator &end) -> Event {
-	Event event{Event::Unknown};
+static MessageError get_event(Iterator &message_iter, const Iterator &end, Event & event) {
+	event=Event::Unknown;
 	parse_type(message_iter,end,event);
 
     if (!contains(event,'A','M','X','T','S')) {
         stats().event_error();
-        throw std::runtime_error("Corruption");
+        return MessageError::Corruption;
     }
 
-    return event;
+    return MessageError::None;
 }
 
 /**
  * Extracts the order object properties from the token list  message event
  *
  * @param message_iter
- * @return
+ * @param order the order of the message
+ * @return None if syntax OK
  */
 template <typename Iterator>
-static auto get_order(Iterator &message_iter, const Iterator &end) -> Order {
+static MessageError get_order(Iterator &message_iter, const Iterator &end, Order & order) {
 	// Order id extract
 	OrderIdKeyType orderid{};
-    if(likely(parse_type(++message_iter,end,orderid))) {
-	   if (!(orderid > 0 && orderid <= max_order_id)) {
+	FieldResult result=parse_bounded(++message_iter,end,orderid,max_order_id);
+    if(unlikely(result!=FieldResult::Ok)) {
+	   if (result==FieldResult::Range) {
 		   stats().order_range();
-		   throw std::runtime_error("Order id range");
+		   return MessageError::OrderIdRange;
 	   }
-    }
-    else {
-    	stats().order_parse();
-    	throw std::runtime_error("Order id syntax");
+	   stats().order_parse();
+	   return MessageError::OrderIdSyntax;
     }
 
     // Side extract
     Side side{Side::Unknown};
 	if (unlikely(!parse_type(++message_iter,end,side))) {
     	stats().side_error();
-    	throw std::runtime_error("Order side syntax");
+    	return MessageError::SideSyntax;
     }
 
     // Quantity extract
     QuantityValueType quantity{};
-	if (likely(parse_type(++message_iter,end,quantity))) {
-		if (!(quantity > 0 && quantity <= max_order_quantity)) {
+	FieldResult quantity_result=parse_bounded(++message_iter,end,quantity,max_order_quantity);
+	if (unlikely(quantity_result!=FieldResult::Ok)) {
+		if (quantity_result==FieldResult::Range) {
 			stats().quantity_range();
-			throw std::runtime_error("Order quantity range");
+			return MessageError::OrderQuantityRange;
 		}
-	}
-	else {
 		stats().quantity_parse();
-		throw std::runtime_error("Order quantity syntax");
+		return MessageError::OrderQuantitySyntax;
 	}
 
     // Price extract
 	PriceLevelKey price{};
-	if (likely(parse_type(++message_iter,end,price))) {
-		if (!(price > 0 && price <= max_order_price)) {
+	FieldResult price_result=parse_bounded(++message_iter,end,price,max_order_price);
+	if (unlikely(price_result!=FieldResult::Ok)) {
+		if (price_result==FieldResult::Range) {
 			stats().price_range();
-			throw std::runtime_error("Order price range");
+			return MessageError::OrderPriceRange;
 		}
-	}
-	else {
 		stats().price_parse();
-		throw std::runtime_error("Order price syntax");
+		return MessageError::OrderPriceSyntax;
 	}
 
 	// I am a pod so optimizer do job
-    return Order{orderid,side,quantity,price};
+    order=Order{orderid,side,quantity,price};
+    return MessageError::None;
 }
 
 /**
  * Extracts the trade properties from the text message event
  *
  * @param message_iter
- * @return
+ * @param trade the trade of the message
+ * @return None if syntax OK
  */
 template <typename Iterator>
-static auto get_trade(Iterator &message_iter, const Iterator &end) -> Trade {
+static MessageError get_trade(Iterator &message_iter, const Iterator &end, Trade & trade) {
     // Side extract
     Side side{Side::Unknown};
 	if (unlikely(!parse_type(++message_iter,end,side))) {
     	stats().side_error();
-    	throw std::runtime_error("Order side syntax");
+    	return MessageError::SideSyntax;
     }
 
     QuantityValueType quantity{};
 	if (likely(parse_type(++message_iter,end,quantity))) {
 		if (quantity<=0) {
 			stats().quantity_range();
-			throw std::runtime_error("Trade quantity range"+quantity);
+			return MessageError::TradeQuantityRange;
 		}
 	}
 	else {
 		stats().quantity_parse();
-		throw std::runtime_error("Trade quantity syntax");
+		return MessageError::TradeQuantitySyntax;
 	}
 
 	PriceLevelKey price{};
 	if (likely(parse_type(++message_iter,end,price))) {
 		if (price<=0) {
 			stats().price_parse();
-			throw std::runtime_error("Trade price range"+price);
+			return MessageError::TradePriceRange;
 		}
 	}
 	else {
 		stats().price_parse();
-		throw std::runtime_error("Trade price is syntax");
+		return MessageError::TradePriceSyntax;
 	}
 
-    return Trade{side,quantity,price};
+    trade=Trade{side,quantity,price};
+    return MessageError::None;
 }
 
 
@@ -210,104 +244,101 @@ static auto get_trade(Iterator &message_iter, const Iterator &end) -> Trade {
  * Extracts the bid order side object properties from the token list message event
  *
  * @param message_iter
- * @return
+ * @param order the bid of the level
+ * @return None if syntax OK
  */
 template <typename Iterator>
-static auto get_snapshot_bid_order(Iterator &message_iter, const Iterator &end) -> Order {
+static MessageError get_snapshot_bid_order(Iterator &message_iter, const Iterator &end, Order & order) {
 	// Order id extract
 	OrderIdKeyType orderid{};
 
 	// Number of contributors in the case of a some simulated snapshots may be set to always 1
 	int num=0;
 	if (likely(!parse_type(++message_iter,end,num))) {
-		throw std::runtime_error("Order number of contributors syntax");
+		return MessageError::ContributorsSyntax;
 	}
 
     // Quantity extract
     QuantityValueType quantity{};
-	if (likely(parse_type(++message_iter,end,quantity))) {
-		if (!(quantity > 0 && quantity <= max_order_quantity)) {
+	FieldResult quantity_result=parse_bounded(++message_iter,end,quantity,max_order_quantity);
+	if (unlikely(quantity_result!=FieldResult::Ok)) {
+		if (quantity_result==FieldResult::Range) {
 			stats().quantity_range();
-			throw std::runtime_error("Order quantity range");
+			return MessageError::OrderQuantityRange;
 		}
-	}
-	else {
 		stats().quantity_parse();
-		throw std::runtime_error("Order quantity syntax");
+		return MessageError::OrderQuantitySyntax;
 	}
 
     // Price extract
 	PriceLevelKey price{};
-	//double dprice;
-	if (likely(parse_type(++message_iter,end,price))) {
-		//price=static_cast<PriceLevelKey>(dprice);
-		if (!(price > 0 && price <= max_order_price)) {
+	FieldResult price_result=parse_bounded(++message_iter,end,price,max_order_price);
+	if (unlikely(price_result!=FieldResult::Ok)) {
+		if (price_result==FieldResult::Range) {
 			stats().price_range();
-			throw std::runtime_error("Order price range");
+			return MessageError::OrderPriceRange;
 		}
-	}
-	else {
 		stats().price_parse();
-		throw std::runtime_error("Order price syntax");
+		return MessageError::OrderPriceSyntax;
 	}
 
 	// In the snapshot, the order is everything accumulated, so we have a
 	// synthetic order id
 	orderid=(1e6+price);
 	// I am a pod so optimizer do job
-    return Order{orderid,Side::Bid,quantity,price};
+    order=Order{orderid,Side::Bid,quantity,price};
+    return MessageError::None;
 }
 
 /**
  * Extracts the bid order side object properties from the text message event
  *
  * @param message_iter
- * @return
+ * @param order the ask of the level
+ * @return None if syntax OK
  */
 template <typename Iterator>
-static auto get_snapshot_ask_order(Iterator &message_iter, const Iterator &end) -> Order {
+static MessageError get_snapshot_ask_order(Iterator &message_iter, const Iterator &end, Order & order) {
 	// Order id extract
 	OrderIdKeyType orderid{};
 
     // Price extract
 	PriceLevelKey price{};
-
-	if (likely(parse_type(++message_iter,end,price))) {
-		if (!(price > 0 && price <= max_order_price)) {
+	FieldResult price_result=parse_bounded(++message_iter,end,price,max_order_price);
+	if (unlikely(price_result!=FieldResult::Ok)) {
+		if (price_result==FieldResult::Range) {
 			stats().price_range();
-			throw std::runtime_error("Order price range");
+			return MessageError::OrderPriceRange;
 		}
-	}
-	else {
 		stats().price_parse();
-		throw std::runtime_error("Order price syntax");
+		return MessageError::OrderPriceSyntax;
 	}
 
     // Quantity extract
     QuantityValueType quantity{};
-	if (likely(parse_type(++message_iter,end,quantity))) {
-		if (!(quantity > 0 && quantity <= max_order_quantity)) {
+	FieldResult quantity_result=parse_bounded(++message_iter,end,quantity,max_order_quantity);
+	if (unlikely(quantity_result!=FieldResult::Ok)) {
+		if (quantity_result==FieldResult::Range) {
 			stats().quantity_range();
-			throw std::runtime_error("Order quantity range");
+			return MessageError::OrderQuantityRange;
 		}
-	}
-	else {
 		stats().quantity_parse();
-		throw std::runtime_error("Order quantity syntax");
+		return MessageError::OrderQuantitySyntax;
 	}
 
 
 	// Number of contributors in the case of a snapshot is set to always 1
 	int num=0;
 	if (likely(!parse_type(++message_iter,end,num))) {
-		throw std::runtime_error("Order number of contributors syntax");
+		return MessageError::ContributorsSyntax;
 	}
 
 	// In the snapshot, the order is everything accumulated, so we have a
 	// synthetic order id
 	orderid=(2e6+price);
 	// I am a pod so optimizer do job
-    return Order{orderid,Side::Ask,quantity,price};
+    order=Order{orderid,Side::Ask,quantity,price};
+    return MessageError::None;
 }
 
 
@@ -317,27 +348,37 @@ static auto get_snapshot_ask_order(Iterator &message_iter, const Iterator &end)
  *
  * @param message_iter
  * @param end
- * @return
+ * @param orders cleared and filled with the orders, the capacity is kept
+ * @return None if syntax OK
  */
 template <typename Iterator>
-static auto get_orders(Iterator &message_iter, const Iterator &end) -> Orders {
-	Orders orders;
+static MessageError get_orders(Iterator &message_iter, const Iterator &end, Orders & orders) {
+	orders.clear();
+	Order order{};
 	while((message_iter+1) != end) {
-		orders.emplace_back(get_snapshot_bid_order(message_iter,end));
-		orders.emplace_back(get_snapshot_ask_order(message_iter,end));
+		MessageError error=get_snapshot_bid_order(message_iter,end,order);
+		if (unlikely(error!=MessageError::None)) {
+			return error;
+		}
+		orders.emplace_back(order);
+		error=get_snapshot_ask_order(message_iter,end,order);
+		if (unlikely(error!=MessageError::None)) {
+			return error;
+		}
+		orders.emplace_back(order);
 	}
-	// Mr compiler lets have some RVO please
-    return orders;
+    return MessageError::None;
 }
 
 /**
  * Extracts the trade properties from the text message event
  *
  * @param message_iter
- * @return
+ * @param trade the trade, the side is Unknown when there is none
+ * @return None if syntax OK
  */
 template <typename Iterator>
-static auto get_snapshot_trade(Iterator &message_iter, const Iterator &end) -> Trade {
+static MessageError get_snapshot_trade(Iterator &message_iter, const Iterator &end, Trade & trade) {
     // Side extract
     Side side{Side::Unknown};
     QuantityValueType quantity{};
@@ -347,30 +388,31 @@ static auto get_snapshot_trade(Iterator &message_iter, const Iterator &end) -> T
 		if (likely(parse_type(++message_iter,end,quantity))) {
 			if (quantity<=0) {
 				stats().quantity_range();
-				throw std::runtime_error("Trade quantity range"+quantity);
+				return MessageError::TradeQuantityRange;
 			}
 		}
 		else {
 			stats().quantity_parse();
-			throw std::runtime_error("Trade quantity syntax");
+			return MessageError::TradeQuantitySyntax;
 		}
 
 		if (likely(parse_type(++message_iter,end,price))) {
 			if (price<=0) {
 				stats().price_parse();
-				throw std::runtime_error("Trade price range"+price);
+				return MessageError::TradePriceRange;
 			}
 		}
 		else {
 			stats().price_parse();
-			throw std::runtime_error("Trade price is syntax");
+			return MessageError::TradePriceSyntax;
 		}
     }
     else {
     	message_iter+=2;
     }
 
-    return Trade{side,quantity,price};
+    trade=Trade{side,quantity,price};
+    return MessageError::None;
 }
 
 /**
@@ -378,12 +420,17 @@ static auto get_snapshot_trade(Iterator &message_iter, const Iterator &end) -> T
  *
  * @param message_iter
  * @param end
- * @return
+ * @param trades cleared and filled with the trade if there is one
+ * @return None if syntax OK
  */
 template <typename Iterator>
-static auto get_trades(Iterator &message_iter, const Iterator &end) -> Trades {
-	Trades trades;
-	Trade trade = get_snapshot_trade(message_iter,end);
+static MessageError get_trades(Iterator &message_iter, const Iterator &end, Trades & trades) {
+	trades.clear();
+	Trade trade{};
+	MessageError error=get_snapshot_trade(message_iter,end,trade);
+	if (unlikely(error!=MessageError::None)) {
+		return error;
+	}
 
 	// Do we have an trade with snapshot
 	if (unlikely(trade.side!=Side::Unknown)) {
@@ -391,9 +438,9 @@ static auto get_trades(Iterator &message_iter, const Iterator &end) -> Trades {
 		trades.emplace_back(trade);
 	}
 
-	// Mr compiler lets have some RVO please
-    return trades;
+    return MessageError::None;
 }
 
 };
 
+#endif
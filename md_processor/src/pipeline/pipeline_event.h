@@ -0,0 +1,130 @@
+#ifndef pipeline_event_h
+#define pipeline_event_h
+
+#include <string_view>
+
+#include "disruptor/interface.h"
+#include "shard/message_event.h"
+
+using namespace disruptor;
+
+/**
+ *  @brief A message as it moves through the stages of the pipeline.
+ *
+ *  The reader stage sets the message, the parse stage fills in the
+ *  parsed record and the book stage applies it. The event stays in the
+ *  ring buffer until the book stage is done with it so the message is
+ *  still there to report a failure.
+ *
+ */
+struct PipelineEvent : public MessageEvent {
+	// The message parsed, event is Unknown if it failed to parse
+	ParsedMessage parsed;
+};
+
+/**
+ *  @brief Implementation of pipeline event factory which creates
+ *  the elements for the ring buffer of the pipeline.
+ *
+ */
+class PipelineEventFactory : public EventFactoryInterface<PipelineEvent> {
+public:
+	virtual ~PipelineEventFactory() = default;
+
+	/**
+	 * Create the events
+	 * @param size number of events for the ring buffer
+	 * @return the events
+	 */
+	virtual PipelineEvent* NewInstance(const int& size) const {
+		return new PipelineEvent[size];
+	}
+};
+
+/**
+ *  @brief The parse stage, tokenizes and parses the message into the
+ *  parsed record of the event.
+ *
+ *  @tparam TokenContainer tokens for the messages
+ *  @tparam MD the md_handler which knows the parser
+ */
+template <typename TokenContainer, typename MD>
+class ParseStageHandler : public EventHandlerInterface<PipelineEvent> {
+public:
+	virtual ~ParseStageHandler() = default;
+
+	/**
+	 * Parse the message, a message that fails is reported and
+	 * left Unknown for the book stage to skip
+	 * @param sequence
+	 * @param end_of_batch
+	 * @param event the message
+	 */
+	virtual void OnEvent(const int64_t& sequence,
+						 const bool& end_of_batch,
+						 PipelineEvent* event) {
+		stats().message();
+		try
+		{
+			TokenContainer tokens=get_tokens<TokenContainer>(std::string_view(event->message));
+			MessageError error=MD::parse_message(tokens, event->parsed);
+			if (unlikely(error!=MessageError::None)) {
+				report_message_error(error, event->message, event->line_number);
+			}
+		}
+		catch(std::exception const& e)
+		{
+			event->parsed.event=Event::Unknown;
+			report_message_error(e, event->message, event->line_number);
+		}
+	}
+
+	virtual void OnStart() {}
+
+	virtual void OnShutdown() {}
+};
+
+/**
+ *  @brief The book stage, applies the parsed record to the order book
+ *  and publishes.
+ *
+ *  @tparam MD the md_handler with the books
+ */
+template <typename MD>
+class BookStageHandler : public EventHandlerInterface<PipelineEvent> {
+public:
+	explicit BookStageHandler(MD & md) : md(md) {
+	}
+	virtual ~BookStageHandler() = default;
+
+	/**
+	 * Apply the message, a message that fails is reported
+	 * @param sequence
+	 * @param end_of_batch
+	 * @param event the message
+	 */
+	virtual void OnEvent(const int64_t& sequence,
+						 const bool& end_of_batch,
+						 PipelineEvent* event) {
+		if (event->parsed.event==Event::Unknown) {
+			// Reported by the parse stage
+			return;
+		}
+		MessageError error=md.apply_parsed(event->parsed);
+		if (unlikely(error!=MessageError::None)) {
+			report_message_error(error, event->message, event->line_number);
+			return;
+		}
+		md.publish(event->parsed.event);
+	}
+
+	virtual void OnStart() {}
+
+	virtual void OnShutdown() {}
+
+private:
+	// The md handler with the books
+	MD & md;
+};
+
+#endif
@@ -1,8 +1,14 @@
 #ifndef data_event_h
 #define data_event_h
 
+#include <memory>
+#include <new>
+
 #include "disruptor/interface.h"
+#include "disruptor/sequence.h"
 #include "md_types.h"
+#include "md_helper.h"
+#include "md_publisher.h"
 
 using namespace disruptor;
 
@@ -10,8 +16,12 @@ using namespace disruptor;
  *  @brief Implementation of data event that will be moved
  *  to into the disruptor ring buffer used by the md_publisher.
  *
+ *  Each event starts on its own cache line and is padded to a whole
+ *  number of them so the producer writing one event and the consumer
+ *  reading the one before never share a line.
+ *
  */
-class BookDataEvent {
+class alignas(CACHE_LINE_SIZE_IN_BYTES) BookDataEvent {
  public:
 	BookDataEvent(const int64_t& value = 0) : value_(value) {}
 
@@ -47,6 +57,14 @@ class BookDataEvent {
     	book_data_ = std::move(book_data);
     }
 
+    /**
+     * The book_data of the event to write in place once claimed
+     * @return the book_data
+     */
+    BookData<5>& book_data_slot() {
+    	return book_data_;
+    }
+
  private:
     // The book data we hold
     BookData<5> book_data_;
@@ -58,9 +76,20 @@ class BookDataEvent {
  *  @brief Implementation of data event factor which creates
  *  the elements for the ring buffer.
  *
+ *  By default the events are from the heap. With hugepages or prefault
+ *  the ring is mapped memory instead @see map_ring_memory so it can be on
+ *  huge pages and have every page faulted in before the first event.
+ *
  */
 class BookDataEventFactory : public EventFactoryInterface<BookDataEvent> {
  public:
+	/**
+	 * @param hugepages back the ring with huge pages
+	 * @param prefault fault in the pages of the ring at startup
+	 */
+	explicit BookDataEventFactory(bool hugepages=false, bool prefault=false) :
+		hugepages(hugepages), prefault(prefault) {
+	}
 	virtual ~BookDataEventFactory() = default;
 
 	/**
@@ -69,8 +98,41 @@ class BookDataEventFactory : public EventFactoryInterface<BookDataEvent> {
 	 * @return the batch of events
 	 */
     virtual BookDataEvent* NewInstance(const int& size) const {
-        return new BookDataEvent[size];
+    	if (!mapped()) {
+    		return new BookDataEvent[size];
+    	}
+    	void* memory=map_ring_memory(sizeof(BookDataEvent)*size, hugepages, prefault);
+    	BookDataEvent* events=static_cast<BookDataEvent*>(memory);
+    	std::uninitialized_default_construct_n(events, size);
+    	return events;
     }
+
+    /**
+     * Release the events made by NewInstance
+     * @param events the batch of events
+     * @param size the ring buffer size
+     */
+    virtual void DeleteInstance(BookDataEvent* events, const int& size) const {
+    	if (!mapped()) {
+    		delete[] events;
+    		return;
+    	}
+    	std::destroy_n(events, size);
+    	unmap_ring_memory(events, sizeof(BookDataEvent)*size, hugepages);
+    }
+
+ private:
+    /**
+     * Is the ring mapped memory rather than from the heap
+     */
+    bool mapped() const {
+    	return hugepages || prefault;
+    }
+
+    // Back the ring with huge pages
+    bool hugepages;
+    // Fault in the pages of the ring at startup
+    bool prefault;
 };
 
 /**
@@ -89,9 +151,11 @@ class BookDataBatchHandler : public EventHandlerInterface<BookDataEvent> {
 	/**
 	 * Select the correct printing functions either for CSV or txt
 	 * @param printType the type of printing we want
+	 * @param shared other threads print too so take the print lock
 	 */
-		BookDataBatchHandler(PrintType printType) :
-			EventHandlerInterface<BookDataEvent>()
+		BookDataBatchHandler(PrintType printType, bool shared=false) :
+			EventHandlerInterface<BookDataEvent>(),
+			shared(shared)
 	{
 			// TODO This should just be a print_publisher
 			// rather than have these print functors
@@ -126,6 +190,10 @@ class BookDataBatchHandler : public EventHandlerInterface<BookDataEvent> {
 		// TODO This should just be a print_publisher
 		// rather than have these print functors
         if (event) {
+        	std::unique_lock<std::mutex> lock(print_mutex(),std::defer_lock);
+        	if (shared) {
+        		lock.lock();
+        	}
         	if (event->book_data().event==Event::Trade) {
         		print_trade_f(std::cout,event->book_data());
         	}
@@ -151,6 +219,8 @@ class BookDataBatchHandler : public EventHandlerInterface<BookDataEvent> {
 	PrintFunctionType<5>::Funcp print_book_f;
 	// Mid price printing function
 	PrintFunctionType<5>::Funcp print_mid_f;
+	// Other threads print too so take the print lock
+	bool shared;
 };
 
 /**
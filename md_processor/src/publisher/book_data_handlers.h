@@ -0,0 +1,228 @@
+#ifndef book_data_handlers_h
+#define book_data_handlers_h
+
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "arguments.h"
+#include "book_data_event.h"
+#include "udp_publisher.h"
+
+/**
+ *  @brief Consumer which sends the book data on with the udp publisher
+ *
+ *  Needs --publish_address as the udp publisher does.
+ *
+ */
+class UdpBatchHandler : public EventHandlerInterface<BookDataEvent> {
+ public:
+	explicit UdpBatchHandler(const arguments& args) : udp(args) {
+	}
+	virtual ~UdpBatchHandler() = default;
+
+    virtual void OnEvent(const int64_t& sequence,
+                         const bool& end_of_batch,
+                         BookDataEvent* event) {
+    	udp.offer(event->book_data());
+    }
+
+    virtual void OnStart() {}
+
+    virtual void OnShutdown() {
+    	udp.stop();
+    }
+
+ private:
+    // Sends each book data as a datagram
+    udp_publisher<5> udp;
+};
+
+/**
+ *  @brief Consumer which journals the book data as it is to a file
+ *
+ *  Each book data is written as the raw BookData<5> record so the file
+ *  can be replayed or archived. The file is given with --journal and
+ *  defaults to book_data.journal. With --shards each shard has its own
+ *  journal, the file with .<shard> after it, so no shard overwrites
+ *  another.
+ *
+ */
+class JournalBatchHandler : public EventHandlerInterface<BookDataEvent> {
+ public:
+	explicit JournalBatchHandler(const arguments& args) :
+		file(::fopen(journal_name(args).c_str(),"wb")) {
+		if (file==nullptr) {
+			throw std::runtime_error("Cannot open journal "+journal_name(args));
+		}
+		::setvbuf(file,nullptr,_IOFBF,journal_buffer_size);
+	}
+	virtual ~JournalBatchHandler() {
+		::fclose(file);
+	}
+
+    virtual void OnEvent(const int64_t& sequence,
+                         const bool& end_of_batch,
+                         BookDataEvent* event) {
+    	::fwrite(&event->book_data_slot(),sizeof(BookData<5>),1,file);
+    }
+
+    virtual void OnStart() {}
+
+    virtual void OnShutdown() {
+    	::fflush(file);
+    }
+
+    /**
+     * The journal file, with the shard after it if there is one
+     * @param args --journal and --shard
+     * @return the file name
+     */
+    static std::string journal_name(const arguments& args) {
+    	std::string name=args.get_opt<std::string>("journal", optional_arg, has_arg, "book_data.journal");
+    	std::string shard=args.get_opt<std::string>("shard", optional_arg, has_arg, "");
+    	return shard.empty() ? name : name+"."+shard;
+    }
+
+ private:
+    // Buffer of the journal file
+    static constexpr std::size_t journal_buffer_size=1<<20;
+
+    // The journal
+    FILE* file;
+};
+
+/**
+ *  @brief Consumer which keeps running figures of the book data, the
+ *  number of each event, the traded quantity and the average spread,
+ *  and prints them when stopped. With --shards each shard has its own
+ *  figures so the summary says which shard it is of.
+ *
+ */
+class AnalyticsBatchHandler : public EventHandlerInterface<BookDataEvent> {
+ public:
+	explicit AnalyticsBatchHandler(const arguments& args) :
+		shard(args.get_opt<std::string>("shard", optional_arg, has_arg, "")) {
+	}
+	virtual ~AnalyticsBatchHandler() = default;
+
+    virtual void OnEvent(const int64_t& sequence,
+                         const bool& end_of_batch,
+                         BookDataEvent* event) {
+    	const BookData<5>& book=event->book_data_slot();
+    	if (book.event==Event::Trade) {
+    		trades++;
+    		traded_quantity+=book.last_trade.quantity;
+    	}
+    	else if (book.event==Event::Mid) {
+    		mids++;
+    		if (book.bdprice[0] > 0 && book.sdprice[0] > 0) {
+    			spreads++;
+    			total_spread+=book.sdprice[0]-book.bdprice[0];
+    		}
+    	}
+    	else {
+    		books++;
+    	}
+    }
+
+    virtual void OnStart() {}
+
+    virtual void OnShutdown() {
+    	int buff_len = 200;
+    	char buffer[buff_len];
+    	snprintf(buffer,buff_len,
+    			"Books: %lu\nMids: %lu\nTrades: %lu\nTraded quantity: %lu\nAverage spread: %.2f\n",
+    			books,mids,trades,traded_quantity,spreads ? total_spread/spreads : 0.0);
+    	std::lock_guard<std::mutex> lock(print_mutex());
+    	if (shard.empty()) {
+    		std::cerr << "Analytics summary\n";
+    	}
+    	else {
+    		std::cerr << "Analytics summary of shard " << shard << "\n";
+    	}
+    	std::cerr << buffer;
+    }
+
+ private:
+    // The shard of the figures, empty without --shards
+    std::string shard;
+    // Book data seen of each event
+    uint64_t books=0;
+    uint64_t mids=0;
+    uint64_t trades=0;
+    // Sum of the quantity of each trade
+    uint64_t traded_quantity=0;
+    // Mids with both sides and the sum of their spreads
+    uint64_t spreads=0;
+    double total_spread=0;
+};
+
+/**
+ * Split the consumers given with --consumers into chains, the chains
+ * are separated by ',' and run in parallel, the consumers of a chain
+ * are separated by ':' and each waits for the one before it. (Not '>'
+ * as the arguments take that as the start of a redirect.)
+ *
+ * i.e "P,U,J:A" prints, sends udp and journals in parallel with the
+ * analytics after the journal
+ *
+ * @param consumers the consumers
+ * @return the chains or empty if the consumers are not valid
+ */
+inline std::vector<std::string> consumer_chains(const std::string& consumers) {
+	std::vector<std::string> chains;
+	std::string chain;
+	// A ':' must have a consumer after it
+	bool waiting=false;
+	for (char c : consumers + ",") {
+		if (c==',' || c==':') {
+			if (chain.empty() || waiting) {
+				return {};
+			}
+			if (c==',') {
+				chains.push_back(chain);
+				chain.clear();
+			}
+			else {
+				waiting=true;
+			}
+		}
+		else if ((c=='P' || c=='U' || c=='J' || c=='A') && (chain.empty() || waiting)) {
+			chain.push_back(c);
+			waiting=false;
+		}
+		else {
+			return {};
+		}
+	}
+	return chains;
+}
+
+/**
+ * Make the handler of a consumer
+ *
+ * @param consumer P print, U udp, J journal or A analytics
+ * @param printType the type of printing for P
+ * @param args the arguments of the consumers
+ * @return the handler
+ */
+inline std::unique_ptr<EventHandlerInterface<BookDataEvent>> make_book_data_handler(char consumer,PrintType printType,const arguments& args) {
+	switch (consumer) {
+	case 'U':
+		return std::make_unique<UdpBatchHandler>(args);
+	case 'J':
+		return std::make_unique<JournalBatchHandler>(args);
+	case 'A':
+		return std::make_unique<AnalyticsBatchHandler>(args);
+	default:
+		return std::make_unique<BookDataBatchHandler>(printType,
+				args.get_opt<std::size_t>("shards", optional_arg, has_arg, 1) > 1);
+	}
+}
+
+#endif
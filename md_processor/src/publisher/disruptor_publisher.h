@@ -7,7 +7,10 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include <disruptor/ring_buffer.h>
 #include <disruptor/event_publisher.h>
@@ -16,6 +19,7 @@
 
 #include "arguments.h"
 #include "book_data_event.h"
+#include "book_data_handlers.h"
 #include "md_publisher.h"
 
 using namespace disruptor;
@@ -31,7 +35,24 @@ using namespace disruptor;
  * this data implement handling classes which can operate on a consumer
  * thread and this off loads the publish to one or many consumers.
  *
- * We are only using one consumer here which you will see in book_data_events.h
+ * The consumers are given with --consumers, by default P which prints
+ * as in book_data_events.h. Consumers separated by ',' each get every
+ * event in parallel on their own thread and a consumer after a ':' only
+ * gets an event once the consumer before it has handled it, i.e
+ * --consumers=P,J:A prints and journals in parallel with analytics after
+ * the journal. The consumers are in book_data_handlers.h
+ *
+ * With --coalesce=LAG when the consumer is more than LAG events behind
+ * the mid and book data are not put on the ring buffer, only the latest
+ * of each is held and put on when the consumer has caught up or before
+ * the next trade, so a slow consumer gets the latest state rather than
+ * every state in between. Trades are never coalesced.
+ *
+ * Book data is claimed and written straight into the slot of the ring
+ * buffer, the consumer reads it there so it is never copied.
+ *
+ * With --hugepages the ring is on huge pages and with --prefault its
+ * pages are all faulted in before we start rather than during the run.
  *
  */
 
@@ -42,30 +63,60 @@ template<int N=5>
 class disruptor_publisher : public md_publisher<N> {
 public:
 	disruptor_publisher(PrintType printType,const arguments& args) : buffer_size(buffSize),
-					book_data_factory{},
+					book_data_factory(args.get_opt<bool>("hugepages", optional_arg, no_arg, false),
+							args.get_opt<bool>("prefault", optional_arg, no_arg, false)),
 					ring_buffer(&book_data_factory, buffer_size,
 					kSingleThreadedStrategy, kBusySpinStrategy),
-					sequence_to_track(0),
-					barrier(ring_buffer.NewBarrier(sequence_to_track)),
-				 	book_data_handler(printType),
 					book_data_exception_handler{},
-					processor(&ring_buffer,
-							  (SequenceBarrierInterface*)barrier.get(),
-							  &book_data_handler,
-							  &book_data_exception_handler),
-					consumer(std::ref<BatchEventProcessor<BookDataEvent>>(processor)),
 					translator(new BookDataEventTranslator),
-					publisher(&ring_buffer)
+					publisher(&ring_buffer),
+					coalesce_lag(args.get_opt<int64_t>("coalesce", optional_arg, has_arg, 0))
 	{
+		std::string names=args.get_opt<std::string>("consumers", optional_arg, has_arg, "P");
+		std::vector<std::string> chains=consumer_chains(names);
+		if (chains.empty()) {
+			throw std::runtime_error("Unknown consumers "+names);
+		}
+
+		for (auto & chain : chains) {
+			// The first of a chain waits only on the producer
+			std::vector<Sequence*> dependents;
+			for (char name : chain) {
+				consumers.emplace_back(std::make_unique<Consumer>(ring_buffer,
+						make_book_data_handler(name,printType,args),
+						dependents,&book_data_exception_handler));
+				dependents={consumers.back()->processor.GetSequence()};
+			}
+			chain_ends.push_back(dependents.front());
+		}
+
+		// The producer must not wrap round on events the last consumer
+		// of any chain has not handled yet
+		ring_buffer.set_gating_sequences(chain_ends);
+
+		for (auto & consumer : consumers) {
+			consumer->thread=std::thread(std::ref(consumer->processor));
+		}
 	}
 
 
 	/**
-	 * Stop the processing and wait for the consumer thread to finish
+	 * Stop the processing and wait for the consumer threads to finish
+	 *
+	 * Anything held back is published and the consumers are allowed to
+	 * handle all events on the ring buffer first
 	 */
 	void stop() {
-		processor.Halt();
-		consumer.join();
+		flush();
+		while (slowest() < ring_buffer.GetCursor()) {
+			std::this_thread::yield();
+		}
+		for (auto & consumer : consumers) {
+			consumer->processor.Halt();
+		}
+		for (auto & consumer : consumers) {
+			consumer->thread.join();
+		}
 	}
 
 	/**
@@ -73,34 +124,160 @@ public:
 	 * @param book_data
 	 */
 	void offer(BookData<5> && book_data) {
+		if (coalesce_lag > 0) {
+			if (book_data.event!=Event::Trade && lagging()) {
+				// Consumer is behind so only keep the latest
+				hold(std::move(book_data));
+				return;
+			}
+			// Keep the order of what was held before this
+			flush();
+		}
+		publish(std::move(book_data));
+	}
+
+	/**
+	 * Claim the next slot of the ring buffer to write in place,
+	 * when coalescing the data is held and offered as it may not
+	 * go on the ring buffer
+	 * @return the book data of the slot
+	 */
+	BookData<5>& claim() {
+		if (coalesce_lag > 0) {
+			return md_publisher<N>::claim();
+		}
+		claimed_sequence=ring_buffer.Next();
+		BookDataEvent* event=ring_buffer.Get(claimed_sequence);
+		event->set_value(claimed_sequence);
+		return event->book_data_slot();
+	}
+
+	/**
+	 * Publish the slot claimed to the consumer
+	 */
+	void publish() {
+		if (coalesce_lag > 0) {
+			md_publisher<N>::publish();
+			return;
+		}
+		ring_buffer.Publish(claimed_sequence);
+	}
+
+private:
+	/**
+	 * Put the book data on the ring buffer
+	 * @param book_data
+	 */
+	void publish(BookData<5> && book_data) {
 		// One copy  of data needed before translator
 		translator->book_data = std::forward<BookData<5>>(book_data);
 		// OnTranslate called in PublishEvent
 		publisher.PublishEvent(translator.get());
 	}
 
-private:
+	/**
+	 * Is the slowest consumer further behind the producer than we allow
+	 */
+	bool lagging() {
+		return ring_buffer.GetCursor()-slowest() > coalesce_lag;
+	}
+
+	/**
+	 * Sequence of the slowest consumer, every event up to it has been
+	 * handled by all the consumers
+	 */
+	int64_t slowest() const {
+		int64_t sequence=chain_ends.front()->sequence();
+		for (auto end : chain_ends) {
+			sequence=std::min(sequence,end->sequence());
+		}
+		return sequence;
+	}
+
+	/**
+	 * @brief A consumer of the events on the ring buffer, the handler
+	 * and the thread processing events with it
+	 */
+	struct Consumer {
+		/**
+		 * @param ring_buffer the events
+		 * @param handler of the events
+		 * @param dependents the consumers this one waits on, none to wait
+		 *        on the producer only
+		 * @param exception_handler for the processor
+		 */
+		Consumer(RingBuffer<BookDataEvent>& ring_buffer,
+				std::unique_ptr<EventHandlerInterface<BookDataEvent>> handler,
+				const std::vector<Sequence*>& dependents,
+				ExceptionHandlerInterface<BookDataEvent>* exception_handler) :
+			handler(std::move(handler)),
+			barrier(ring_buffer.NewBarrier(dependents)),
+			processor(&ring_buffer,
+					  (SequenceBarrierInterface*)barrier.get(),
+					  this->handler.get(),
+					  exception_handler) {
+		}
+
+		// The handler which with action on the data message
+		std::unique_ptr<EventHandlerInterface<BookDataEvent>> handler;
+		// Sequence barrier on the producer or consumers before
+		std::unique_ptr<ProcessingSequenceBarrier> barrier;
+		// Processor which gathers batches of data messages put on ring buffer
+		BatchEventProcessor<BookDataEvent> processor;
+		// The thread this consumer runs in
+		std::thread thread;
+	};
+
+	/**
+	 * Hold the book data replacing any of the same kind held
+	 * @param book_data
+	 */
+	void hold(BookData<5> && book_data) {
+		if (book_data.event==Event::Mid) {
+			pending_mid=std::move(book_data);
+		}
+		else {
+			pending_book=std::move(book_data);
+		}
+	}
+
+	/**
+	 * Publish what is held, mid first as it would have been offered
+	 */
+	void flush() {
+		if (pending_mid) {
+			publish(std::move(*pending_mid));
+			pending_mid.reset();
+		}
+		if (pending_book) {
+			publish(std::move(*pending_book));
+			pending_book.reset();
+		}
+	}
+
 	// Ring buffer size
 	int buffer_size;
 	// The events produced for the ring buffer
 	BookDataEventFactory book_data_factory;
 	// The ring buffer used in disruptor
 	RingBuffer<BookDataEvent> ring_buffer;
-	// Sequence number tracking of messages
-	std::vector<Sequence*> sequence_to_track;
-	// producer/consumer sequence barrier
-	std::unique_ptr<ProcessingSequenceBarrier> barrier;
-	// The handler which with action on the data message
-	BookDataBatchHandler book_data_handler;
 	// Exception handling
 	IgnoreExceptionHandler<BookDataEvent> book_data_exception_handler;
-	// Processor which gathers batches of data messages put on ring buffer
-	BatchEventProcessor<BookDataEvent> processor;
-	// The thread our off loaded consumer runs in
-	std::thread consumer;
+	// The consumers in the order of their chains
+	std::vector<std::unique_ptr<Consumer>> consumers;
+	// Sequence of the last consumer of each chain
+	std::vector<Sequence*> chain_ends;
 	// Custom translator for data messages i.e book_data
 	std::unique_ptr<BookDataEventTranslator> translator;
 	EventPublisher<BookDataEvent> publisher;
+	// Events the slowest consumer may fall behind before we coalesce, 0 never
+	int64_t coalesce_lag;
+	// Latest mid data held while the consumer is behind
+	std::optional<BookData<5>> pending_mid;
+	// Latest book data held while the consumer is behind
+	std::optional<BookData<5>> pending_book;
+	// Sequence of the slot claimed to write in place
+	int64_t claimed_sequence=0;
 };
 
 #endif
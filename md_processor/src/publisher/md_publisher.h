@@ -1,10 +1,18 @@
 #ifndef md_publisher_h
 #define md_publisher_h
 
+#include <mutex>
+
 #include "md_types.h"
 
 /**
  * @brief Interface for publisher so they implement stop and offer
+ *
+ * Rather than offer a copy the data can be written in place, claim
+ * the data to write, fill it i.e with OrderBook::book_data and then
+ * publish it. By default the claimed data is held here and offered, a
+ * publisher with somewhere better to write it, such as a ring buffer
+ * slot, overrides both.
  */
 template <int N=5>
 class md_publisher {
@@ -12,6 +20,35 @@ public:
 	virtual ~md_publisher() {}
 	virtual void stop()=0;
 	virtual void offer(BookData<N> && book_data)=0;
+
+	/**
+	 * The data to write before @see publish
+	 * @return the data, whatever it held before
+	 */
+	virtual BookData<N>& claim() {
+		return claimed;
+	}
+
+	/**
+	 * Publish the data written since @see claim
+	 */
+	virtual void publish() {
+		offer(std::move(claimed));
+	}
+
+private:
+	// Data claimed by default
+	BookData<N> claimed;
 };
 
+/**
+ * Lock for printing when several threads publish to the same stream,
+ * i.e each shard with --shards, so the lines of a book are not mixed
+ * @return the lock
+ */
+inline std::mutex& print_mutex() {
+	static std::mutex instance;
+	return instance;
+}
+
 #endif
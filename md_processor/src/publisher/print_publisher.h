@@ -13,7 +13,8 @@
 template<int N=5>
 class print_publisher : public md_publisher<N> {
 public:
-	print_publisher(PrintType printType,const arguments& args)
+	print_publisher(PrintType printType,const arguments& args) :
+		shared(args.get_opt<std::size_t>("shards", optional_arg, has_arg, 1) > 1)
 	{
 		if (printType==PrintType::Trading) {
 			print_trade_f=print_trade_txt<N>;
@@ -36,6 +37,17 @@ public:
 	}
 
 	void offer(BookData<N> && book_data) {
+		if (shared) {
+			std::lock_guard<std::mutex> lock(print_mutex());
+			print(std::forward<BookData<N>>(book_data));
+		}
+		else {
+			print(std::forward<BookData<N>>(book_data));
+		}
+	}
+
+private:
+	void print(BookData<N> && book_data) {
 		if (book_data.event==Event::Trade) {
 			print_trade_f(std::cout,std::forward<BookData<N>>(book_data));
 		}
@@ -47,8 +59,8 @@ public:
 		}
 	}
 
-private:
-private:
+   // Other threads print too so take the print lock
+	bool shared;
    // Trade event printing function
 	typename PrintFunctionType<N>::Funcp print_trade_f;
 	// Book event printing function
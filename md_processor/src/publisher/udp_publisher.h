@@ -14,7 +14,6 @@ template<int N=5>
 class udp_publisher : public md_publisher<N> {
 public:
     udp_publisher() :
-     _logger(Logger::getLogger("udp_publisher")),
      publisher(_io_service)
     {         
     }
@@ -23,14 +22,12 @@ public:
 	}
 
     udp_publisher(const udp::endpoint & endpoint,bool multicast) :
-     _logger(Logger::getLogger("udp_publisher")),
      publisher(_io_service)
     {         
         init(multicast);
     }
      
     udp_publisher(std::string address,std::string port,bool multicast) :
-     _logger(Logger::getLogger("udp_publisher")),
      publisher(_io_service),
      _endpoint(boost::asio::ip::address::from_string(address), std::stoi(port))
     {         
@@ -38,7 +35,6 @@ public:
     }
 
     udp_publisher(const arguments & args) :
-    _logger(Logger::getLogger("udp_publisher")),
     publisher(_io_service)
     {
         const std::string sink_address = args.get_opt<std::string>("publish_address",mandatory_arg,has_arg,"");
@@ -48,7 +44,7 @@ public:
         if (sep_index != std::string::npos) {
             std::string ip = sink_address.substr(0, sep_index);
             int port = ::atoi(sink_address.substr(sep_index + 1, sink_address.size()).c_str());
-            LOG_INFO(_logger, "Adding publisher:" << sink_address);
+            async_log().log(LogFormat::UdpAddingPublisher, sink_address);
             _endpoint.address(boost::asio::ip::address::from_string(ip));
             _endpoint.port(port);
         }
@@ -65,10 +61,11 @@ public:
         publisher.open(_endpoint.protocol(), errorCode);
 
         if (errorCode) {
-                LOG_FATAL(_logger, "Failed to open socket - error code [" << errorCode.value() << "]");
+                async_log().log(LogFormat::UdpOpenFailed, errorCode.value());
+                async_log().flush();
                 exit(errorCode.value());
         } else {
-                LOG_INFO(_logger, "Opened socket");
+                async_log().log(LogFormat::UdpOpenedSocket);
         }
 
         if (!multicast) publisher.set_option(boost::asio::ip::udp::socket::broadcast(true));
@@ -81,7 +78,11 @@ public:
 	void offer(BookData<N> && book_data) {
         size_t len = sizeof(BookData<N>);
         publisher.async_send_to(boost::asio::buffer((void*)&book_data, len), _endpoint,
-        [this](boost::system::error_code, std::size_t) {});
+        [](boost::system::error_code errorCode, std::size_t) {
+            if (errorCode) {
+                async_log().log(LogFormat::UdpSendFailed, errorCode.value());
+            }
+        });
 	}
           
     const udp::endpoint & endpoint() const noexcept {
@@ -98,7 +99,6 @@ public:
         return publisher.is_open();
     }
 private:
-    LoggerPtr _logger;
     constexpr static const int buffer_size = 2048;
     std::array<unsigned char, buffer_size> pCmp;
 
@@ -0,0 +1,105 @@
+#ifndef message_event_h
+#define message_event_h
+
+#include <string>
+#include <string_view>
+
+#include "disruptor/interface.h"
+#include "md_error_log.h"
+#include "md_stats.h"
+
+using namespace disruptor;
+
+/**
+ *  @brief A raw message on its way to the shard that owns its instrument.
+ *
+ *  The message is copied into the event as it was read so the shard does
+ *  all of the tokenizing and parsing. The string keeps its capacity
+ *  between uses of the event so once the ring buffer is warm there is no
+ *  allocation.
+ *
+ */
+struct MessageEvent {
+	/**
+	 * Set the message
+	 * @param line the message as read
+	 * @param number line number of the message in the input
+	 */
+	void set(std::string_view line, int number) {
+		message.assign(line.data(), line.size());
+		line_number=number;
+	}
+
+	// The message as read
+	std::string message;
+	// Where the message was in the input, for reporting errors
+	int line_number=0;
+};
+
+/**
+ *  @brief Implementation of message event factory which creates
+ *  the elements for the ring buffer of a shard.
+ *
+ */
+class MessageEventFactory : public EventFactoryInterface<MessageEvent> {
+public:
+	virtual ~MessageEventFactory() = default;
+
+	/**
+	 * Create the events
+	 * @param size number of events for the ring buffer
+	 * @return the events
+	 */
+	virtual MessageEvent* NewInstance(const int& size) const {
+		return new MessageEvent[size];
+	}
+};
+
+/**
+ *  @brief This is the handler of a shard which receives the messages
+ *  put onto its ring buffer and processes them with the shard's own
+ *  md handler, so its own order books.
+ *
+ *  This is operating in the shard thread, the messages are put on the
+ *  ring buffer by the adapter thread.
+ *
+ *  @tparam TokenContainer tokens for the messages
+ *  @tparam MD the md_handler of the shard
+ */
+template <typename TokenContainer, typename MD>
+class MessageEventHandler : public EventHandlerInterface<MessageEvent> {
+public:
+	explicit MessageEventHandler(MD & md) : md(md) {
+	}
+	virtual ~MessageEventHandler() = default;
+
+	/**
+	 * Process the message, a message that fails is reported
+	 * to the error log as the adapter would
+	 * @param sequence
+	 * @param end_of_batch
+	 * @param event the message
+	 */
+	virtual void OnEvent(const int64_t& sequence,
+						 const bool& end_of_batch,
+						 MessageEvent* event) {
+		try
+		{
+			md.template process_line<TokenContainer>(std::string_view(event->message), event->line_number);
+		}
+		catch(std::exception const& e)
+		{
+			report_message_error(e, event->message, event->line_number);
+		}
+	}
+
+	virtual void OnStart() {}
+
+	virtual void OnShutdown() {}
+
+private:
+	// The md handler of the shard
+	MD & md;
+};
+
+#endif
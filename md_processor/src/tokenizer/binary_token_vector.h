@@ -0,0 +1,264 @@
+#ifndef binary_token_vector_h
+#define binary_token_vector_h
+
+#include <endian.h>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Binary wire format for market data messages
+ *
+ * A message is a fixed header followed by the fields of the message, each
+ * field a little endian 32 bit word. The fields are in the same order as
+ * the tokens of a csv line so the list parser reads them the same way.
+ *
+ *   header | length:16 | count:16 |
+ *   fields | word:32 ... x count  |
+ *
+ * length is the number of bytes in the message including the header and
+ * count the number of fields. Events and sides are carried as their char
+ * code i.e 'A','M','X','T','S' and 'B','S'. A field which was not a valid
+ * number in the source is sent as binary_invalid_field so it is reported
+ * as a syntax error as it would be for text.
+ *
+ *   Add/Modify/Cancel | event | orderid | side | quantity | price |
+ *   Trade             | event | side | quantity | price |
+ *   Snapshot          | event | side | quantity | price | (bid contr | bid quantity | bid price |
+ *                       ask price | ask quantity | ask contr) per level
+ *
+ * In a file messages simply follow one another, over zeromq or pcap each
+ * message is one frame or packet.
+ */
+typedef struct {
+	// Bytes in the message including this header
+	uint16_t length;
+	// Number of 32 bit fields after the header
+	uint16_t count;
+} binary_header;
+
+// Field value that marks a field with no valid number
+constexpr uint32_t binary_invalid_field=0xFFFFFFFF;
+
+/**
+ *  @brief  Length of the message at the start of some bytes
+ *  @param  data start of the message
+ *  @param  size bytes available
+ *  @return length of the message from the header or 0 if the header
+ *          is incomplete
+ *
+ */
+inline std::size_t binary_message_length(const char* data,std::size_t size) {
+	if (size < sizeof(binary_header)) {
+		return 0;
+	}
+	uint16_t length;
+	std::memcpy(&length,data,sizeof(length));
+	return le16toh(length);
+}
+
+/**
+ * @brief Token container for the binary format
+ *
+ * Decodes the fields of one message into host order words. Like the
+ * char_token_vector the first inline_tokens are held inside the container
+ * and only snapshots spill into a std::vector.
+ *
+ * Exposes iterator class for use with token content
+ */
+struct binary_token_vector
+{
+	typedef uint32_t value_type;
+	typedef const uint32_t& reference;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	// Number of fields held without allocating
+	static constexpr size_type inline_tokens=8;
+
+	class iterator {
+	public:
+		typedef std::ptrdiff_t difference_type;
+		typedef uint32_t value_type;
+		typedef const uint32_t& reference;
+		typedef const uint32_t* pointer;
+		typedef std::random_access_iterator_tag iterator_category;
+
+		iterator () = delete;
+		iterator (const iterator&) = default;
+		~iterator() = default;
+
+		explicit iterator(pointer it) : current(it) {}
+
+		iterator& operator=(const iterator&) = default;
+
+		bool operator==(const iterator& rhs) const {
+			return current == rhs.current;
+		}
+
+		bool operator!=(const iterator& rhs) const {
+			return current != rhs.current;
+		}
+
+		iterator& operator ++() {
+			++current;
+			return *this;
+		}
+
+		iterator operator ++(int) {
+			iterator tmp(*this);
+			operator ++();
+			return tmp;
+		}
+
+		iterator& operator --() {
+			--current;
+			return *this;
+		}
+
+		iterator operator --(int) {
+			iterator tmp(*this);
+			operator --();
+			return tmp;
+		}
+
+		iterator& operator+=(size_type n) {
+			current+=n;
+			return *this;
+		}
+
+		iterator operator+(size_type n) const {
+			return iterator(current+n);
+		}
+
+		iterator& operator-=(size_type n) {
+			current-=n;
+			return *this;
+		}
+
+		iterator operator-(size_type n) const {
+			return iterator(current-n);
+		}
+
+		difference_type operator-(iterator rhs) const {
+			return current-rhs.current;
+		}
+
+		reference operator*() const noexcept {
+			return *current;
+		}
+
+		pointer operator->() const noexcept {
+			return current;
+		}
+
+		reference operator[](size_type i) const {
+			return current[i];
+		}
+
+	private:
+		pointer current;
+	};
+
+	/**
+	 * Decode a message, the view must hold exactly one message
+	 *
+	 * @param message bytes of the message
+	 */
+	explicit binary_token_vector(std::string_view message) {
+		std::size_t length=binary_message_length(message.data(),message.size());
+		if (length!=message.size()) {
+			throw std::runtime_error("Binary message length");
+		}
+		binary_header header;
+		std::memcpy(&header,message.data(),sizeof(header));
+		count=le16toh(header.count);
+		if (sizeof(binary_header)+count*sizeof(uint32_t)!=length) {
+			throw std::runtime_error("Binary message field count");
+		}
+
+		uint32_t* fields=inline_index.data();
+		if (count > inline_tokens) {
+			spill_index.resize(count);
+			fields=spill_index.data();
+		}
+		std::memcpy(fields,message.data()+sizeof(binary_header),count*sizeof(uint32_t));
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+		for (size_type i=0; i < count; i++) {
+			fields[i]=le32toh(fields[i]);
+		}
+#endif
+	}
+
+	iterator begin() const noexcept {
+		return iterator(data());
+	}
+
+	iterator end() const noexcept {
+		return iterator(data()+count);
+	}
+
+	reference operator[](size_type i) const {
+		return data()[i];
+	}
+
+	size_type size() const noexcept {
+		return count;
+	}
+
+private:
+	const uint32_t* data() const noexcept {
+		return spill_index.empty() ? inline_index.data() : spill_index.data();
+	}
+
+	std::array<uint32_t,inline_tokens> inline_index;
+	std::vector<uint32_t> spill_index;
+	size_type count=0;
+};
+
+/**
+ * @brief Splits a memory range into binary messages
+ *
+ * Steps from header to header using the message length. A message cut
+ * short by the end of the range is returned as is so it is reported when
+ * it is decoded.
+ *
+ */
+class binary_scanner {
+public:
+	binary_scanner(const char* first,const char* last) :
+		pos(first),last(last) {
+	}
+
+	/**
+	 *  @brief  Get the next message
+	 *  @param  message view of the message
+	 *  @return True if there was a message
+	 *
+	 */
+	bool next(std::string_view & message) {
+		if (pos==last) {
+			return false;
+		}
+		std::size_t size=last-pos;
+		std::size_t length=binary_message_length(pos,size);
+		if (length==0 || length > size) {
+			length=size;
+		}
+		message=std::string_view(pos,length);
+		pos+=length;
+		return true;
+	}
+
+private:
+	// Start of the next message
+	const char* pos;
+	// End of the data
+	const char* last;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef simd_scan_h
+#define simd_scan_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "vectorclass.h"
+
+/**
+ * @brief Vectorized search for delimiters and new lines
+ *
+ * Compare a block of characters against the character we are looking for
+ * in one instruction and turn the result into a bit mask, one bit for each
+ * character that matched. The matches are then taken from the mask lowest
+ * bit first so every delimiter in a block is found from a single compare.
+ *
+ * Using VCL as included in vectorclass sub dir. The vector size is chosen
+ * at compile time from INSTRSET, as with the vector_sum in BookVector, so
+ * AVX2 builds use 32 characters a block and anything older 16 (SSE2).
+ *
+ */
+#if INSTRSET >= 8
+// AVX2, 32 characters a block
+typedef Vec32c ScanVec;
+typedef uint32_t ScanMask;
+constexpr std::ptrdiff_t scan_width=32;
+#else
+// SSE2, 16 characters a block
+typedef Vec16c ScanVec;
+typedef uint16_t ScanMask;
+constexpr std::ptrdiff_t scan_width=16;
+#endif
+
+/**
+ *  @brief  Mask of the characters in a block that match
+ *  @param  block start of the block
+ *  @param  last end of the data, the block may be cut short by it
+ *  @param  match the character to look for in every lane
+ *  @return bit i set if block[i] matches
+ *
+ *  A short block at the end is loaded partially so we never read past
+ *  last, the lanes not loaded are zero.
+ *
+ */
+inline ScanMask scan_block(const char* block,const char* last,const ScanVec& match) {
+	ScanVec chars;
+	if (last-block >= scan_width) {
+		chars.load(block);
+	}
+	else {
+		chars.load_partial(static_cast<int>(last-block),block);
+	}
+	return to_bits(chars==match);
+}
+
+/**
+ *  @brief  Split a range into tokens on a delimiter
+ *  @tparam Token Callable (first, last) for each token
+ *  @param  first start of the range
+ *  @param  last end of the range
+ *  @param  delim token delimiter, must not be '\0'
+ *  @param  token called for every token in order
+ *
+ *  There is always at least one token, the last token ends at last
+ *
+ */
+template<typename Token>
+inline void scan_tokens(const char* first,const char* last,char delim,Token token) {
+	const ScanVec match(delim);
+	const char* start=first;
+	for (const char* block=first; block < last; block+=scan_width) {
+		for (ScanMask bits=scan_block(block,last,match); bits; bits&=bits-1) {
+			const char* d=block+__builtin_ctz(bits);
+			token(start,d);
+			start=d+1;
+		}
+	}
+	token(start,last);
+}
+
+/**
+ * @brief Splits a memory range into lines
+ *
+ * The new lines of a block are found together and kept in a mask so
+ * following lines in the same block need no further compare.
+ *
+ * The last line does not need to end in a new line
+ *
+ */
+class line_scanner {
+public:
+	line_scanner(const char* first,const char* last) :
+		block(first),pos(first),last(last),match('\n') {
+		if (first < last) {
+			bits=scan_block(block,last,match);
+		}
+	}
+
+	/**
+	 *  @brief  Get the next line
+	 *  @param  line view of the line without the new line
+	 *  @return True if there was a line
+	 *
+	 */
+	bool next(std::string_view & line) {
+		if (pos==last) {
+			return false;
+		}
+		while (!bits) {
+			block+=scan_width;
+			if (block >= last) {
+				// No more new lines, what is left is the last line
+				line=std::string_view(pos,last-pos);
+				pos=last;
+				return true;
+			}
+			bits=scan_block(block,last,match);
+		}
+		const char* nl=block+__builtin_ctz(bits);
+		bits&=bits-1;
+		line=std::string_view(pos,nl-pos);
+		pos=nl+1;
+		return true;
+	}
+
+private:
+	// Start of the block that bits is for
+	const char* block;
+	// Start of the next line
+	const char* pos;
+	// End of the data
+	const char* last;
+	// New line in every lane
+	const ScanVec match;
+	// New lines in the block not yet returned
+	ScanMask bits{};
+};
+
+#endif
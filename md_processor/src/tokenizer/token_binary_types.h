@@ -0,0 +1,96 @@
+#ifndef token_binary_types_h
+#define token_binary_types_h
+
+#include "token_containers.h"
+
+/**
+ * Handle arithmetic types, the field is already a number so
+ * only the invalid field marker can fail
+ *
+ * @param itr
+ * @param end
+ * @param result
+ * @param
+ * @return True if the field is a number
+ */
+template <typename T>
+inline bool make_type(binary_token_vector::iterator itr, const binary_token_vector::iterator end, T &result,
+		typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T,char>::value>::type* = 0) {
+	if (end == itr || *itr == binary_invalid_field) return false;
+	result=static_cast<T>(*itr);
+	return true;
+}
+
+/**
+ * Handle single char
+ *
+ * @param itr
+ * @param end
+ * @param t
+ * @return True if one char OK
+ */
+inline bool make_type(binary_token_vector::iterator itr, const binary_token_vector::iterator end, char& t) {
+	if (end == itr || *itr == binary_invalid_field) return false;
+	t=static_cast<char>(*itr);
+	return true;
+}
+
+/**
+ * Make type implementation for Event enums
+ * need specific handling
+ *
+ * @param itr
+ * @param end
+ * @param side
+ * @return True if syntax OK
+ */
+inline bool make_type(binary_token_vector::iterator itr, const binary_token_vector::iterator end, Event & event) {
+	if (end == itr) return false;
+	switch (*itr) {
+	case 'A':
+		event=Event::Add;
+		break;
+	case 'M':
+		event=Event::Modify;
+		break;
+	case 'X':
+		event=Event::Cancel;
+		break;
+	case 'T':
+		event=Event::Trade;
+		break;
+	case 'S':
+		event=Event::Snapshot;
+		break;
+	default:
+		event=Event::Unknown;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Make type implementation Side enums
+ * need specific handling
+ *
+ * @param itr
+ * @param end
+ * @param side
+ * @return True if syntax OK
+ */
+inline bool make_type(binary_token_vector::iterator itr, const binary_token_vector::iterator end, Side & side) {
+	if (end == itr) return false;
+	if (*itr=='B')
+		side=Side::Bid;
+	else if (*itr=='S')
+		side=Side::Ask;
+	else {
+		side=Side::Unknown;
+		return false;
+	}
+
+	return true;
+}
+
+#endif
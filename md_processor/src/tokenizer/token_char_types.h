@@ -2,8 +2,53 @@
 #ifndef token_char_types_h
 #define token_char_types_h
 
+#include <limits>
+#include <string_view>
+
 #include "token_containers.h"
 
+/**
+ * Parse an unsigned number from a token without allocating
+ *
+ * Accepts what strtk accepts for unsigned types, an optional '+' then
+ * digits only. The value is clamped just past the largest T so a long
+ * run of digits cannot wrap, anything past the largest T is a syntax
+ * error as it would be with strtk. Zero or above max is a range error.
+ *
+ * @param token the characters of the field
+ * @param result the value if Ok
+ * @param max highest value allowed
+ * @return Ok, Syntax or Range
+ */
+template <typename T>
+inline FieldResult parse_unsigned(std::string_view token, T &result, const T max) {
+	static_assert(std::is_unsigned<T>::value && sizeof(T) < sizeof(uint64_t),"Unsigned type smaller than 64 bits");
+	constexpr uint64_t overflow = uint64_t(std::numeric_limits<T>::max()) + 1;
+
+	const char* c = token.data();
+	const char* end = c + token.size();
+	if (c != end && *c == '+') {
+		++c;
+	}
+	if (c == end) {
+		return FieldResult::Syntax;
+	}
+
+	uint64_t value = 0;
+	unsigned bad = 0;
+	for (; c != end; ++c) {
+		unsigned digit = static_cast<unsigned char>(*c) - '0';
+		bad |= (digit > 9);
+		value = std::min(value * 10 + digit, overflow);
+	}
+
+	if (bad || value == overflow) {
+		return FieldResult::Syntax;
+	}
+	result = static_cast<T>(value);
+	return (value > 0 && value <= max) ? FieldResult::Ok : FieldResult::Range;
+}
+
 /**
  * Handle floating types
  * Using strtk included and all copyright honoured
@@ -19,7 +64,8 @@ template <typename T>
 inline bool make_type(char_token_vector::iterator itr, const char_token_vector::iterator end, T &result,
 		typename std::enable_if<std::is_floating_point<T>::value >::type* = 0 ) {
 	if (end == itr) return false;
-	return strtk::string_to_type_converter(std::string(*itr),result);
+	char_token_vector::reference i = *itr;
+	return strtk::string_to_type_converter(i.data(),i.data()+i.size(),result);
 }
 
 /**
@@ -35,9 +81,43 @@ inline bool make_type(char_token_vector::iterator itr, const char_token_vector::
  */
 template <typename T>
 inline bool make_type(char_token_vector::iterator itr, const char_token_vector::iterator end, T &result,
-		typename std::enable_if<std::is_integral<T>::value >::type* = 0) {
+		typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value >::type* = 0) {
 	if (end == itr) return false;
-	return strtk::string_to_type_converter(std::string(*itr),result);
+	char_token_vector::reference i = *itr;
+	return strtk::string_to_type_converter(i.data(),i.data()+i.size(),result);
+}
+
+/**
+ * Handle an unsigned integer type
+ * @see parse_unsigned
+ *
+ * @param itr
+ * @param end
+ * @param result
+ * @param
+ * @return True if its an integer OK
+ */
+template <typename T>
+inline bool make_type(char_token_vector::iterator itr, const char_token_vector::iterator end, T &result,
+		typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value >::type* = 0) {
+	if (end == itr) return false;
+	return parse_unsigned(*itr,result,std::numeric_limits<T>::max())!=FieldResult::Syntax;
+}
+
+/**
+ * Handle an unsigned field which must be in the range 1 to max,
+ * parsed and range checked in the one pass @see parse_unsigned
+ *
+ * @param itr
+ * @param end
+ * @param result
+ * @param max highest value allowed
+ * @return Ok, Syntax or Range
+ */
+template <typename T>
+inline FieldResult make_bounded(char_token_vector::iterator itr, const char_token_vector::iterator end, T &result, const T max) {
+	if (end == itr) return FieldResult::Syntax;
+	return parse_unsigned(*itr,result,max);
 }
 
 /**
@@ -50,8 +130,8 @@ inline bool make_type(char_token_vector::iterator itr, const char_token_vector::
 inline bool make_type(char_token_vector::iterator itr, const char_token_vector::iterator end, char* t) {
 	if (end == itr) return false;
 	char_token_vector::reference i = *itr;
-	while (end != itr && *t) {
-		*(t++)=*(i++);
+	for (auto c=i.begin(); c != i.end() && *t; ++c) {
+		*(t++)=*c;
 	}
 	*t='\0';
 	return true;
@@ -66,7 +146,7 @@ inline bool make_type(char_token_vector::iterator itr, const char_token_vector::
  * @return True if one char OK
  */
 inline bool make_type(char_token_vector::iterator itr, const char_token_vector::iterator end, char& t) {
-	if (end == itr) return false;
+	if (end == itr || itr->empty()) return false;
 	char_token_vector::reference i = *itr;
 	t=i[0];
 	return true;
@@ -82,7 +162,7 @@ inline bool make_type(char_token_vector::iterator itr, const char_token_vector::
  * @return True if syntax OK
  */
 inline bool make_type(char_token_vector::iterator itr, const char_token_vector::iterator end, Event & event) {
-	if (end == itr) return false;
+	if (end == itr || itr->empty()) return false;
 	char_token_vector::reference i = *itr;
 	if (i[0]=='A')
 		event=Event::Add;
@@ -92,6 +172,8 @@ inline bool make_type(char_token_vector::iterator itr, const char_token_vector::
 		event=Event::Cancel;
 	else if (i[0]=='T')
 		event=Event::Trade;
+	else if (i[0]=='S')
+		event=Event::Snapshot;
 	else {
 		event=Event::Unknown;
 		return false;
@@ -110,7 +192,7 @@ inline bool make_type(char_token_vector::iterator itr, const char_token_vector::
  * @return True if syntax OK
  */
 inline bool make_type(char_token_vector::iterator itr, const char_token_vector::iterator end, Side & side) {
-	if (end == itr) return false;
+	if (end == itr || itr->empty()) return false;
 	char_token_vector::reference i = *itr;
 	if (i[0]=='B')
 		side=Side::Bid;
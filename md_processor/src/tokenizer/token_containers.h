@@ -4,11 +4,23 @@
 #include "json_spirit/json_spirit_reader_template.h"
 #include "strtk/strtk.hpp"
 #include "token_vector.h"
+#include "binary_token_vector.h"
+#include "simd_scan.h"
 
 typedef json_spirit::Array json_token_array;
 typedef std::vector<std::string> string_token_vector;
 typedef token_vector<char> char_token_vector;
 
+/**
+ * Result of parsing a bounded number field, syntax errors and
+ * out of range values are recorded as different statistics
+ */
+enum class FieldResult {
+	Ok,
+	Syntax,
+	Range
+};
+
 
 template <typename T>
 inline typename std::enable_if<std::is_same<T, json_token_array>::value,json_token_array>::type
@@ -28,11 +40,81 @@ get_tokens(const std::string& line) {
 	return token_list;
 }
 
+/**
+ * The json and string token containers copy the tokens anyway so a
+ * line view, from a memory mapped file, is copied into a string for them
+ */
+template <typename T>
+inline typename std::enable_if<std::is_same<T, json_token_array>::value || std::is_same<T, string_token_vector>::value,T>::type
+get_tokens(std::string_view line) {
+	return get_tokens<T>(std::string(line));
+}
+
+/**
+ * The char token container only views the line so a std::string
+ * or a view of a memory mapped file are tokenized in place
+ */
 template <typename T>
 inline typename std::enable_if<std::is_same<T, char_token_vector>::value,char_token_vector>::type
-get_tokens(std::string& line) {
+get_tokens(std::string_view line) {
 	char_token_vector token_list(line);
 	return token_list;
 }
 
+/**
+ * The binary token container decodes the fields of the message,
+ * the view must hold exactly one message
+ */
+template <typename T>
+inline typename std::enable_if<std::is_same<T, binary_token_vector>::value,binary_token_vector>::type
+get_tokens(std::string_view message) {
+	binary_token_vector token_list(message);
+	return token_list;
+}
+
+/**
+ * Read the next message from a stream, text messages are a line
+ *
+ * @param in stream to read from
+ * @param message the message read
+ * @return True if there was a message
+ */
+template <typename T>
+inline typename std::enable_if<!std::is_same<T, binary_token_vector>::value,bool>::type
+get_message(std::istream& in, std::string& message) {
+	return static_cast<bool>(std::getline(in, message));
+}
+
+/**
+ * Read the next message from a stream, binary messages are the header
+ * and the fields it gives the length of
+ *
+ * @param in stream to read from
+ * @param message the message read
+ * @return True if there was a message
+ */
+template <typename T>
+inline typename std::enable_if<std::is_same<T, binary_token_vector>::value,bool>::type
+get_message(std::istream& in, std::string& message) {
+	message.resize(sizeof(binary_header));
+	if (!in.read(&message[0], sizeof(binary_header))) {
+		return false;
+	}
+	std::size_t length=binary_message_length(message.data(), message.size());
+	if (length > sizeof(binary_header)) {
+		message.resize(length);
+		in.read(&message[sizeof(binary_header)], length-sizeof(binary_header));
+		// A short read leaves the message as it is to be reported when decoded
+		message.resize(sizeof(binary_header)+in.gcount());
+	}
+	return true;
+}
+
+/**
+ * Splits a memory mapped file into messages, lines for text
+ * and length framed messages for binary
+ */
+template <typename T>
+using message_scanner = typename std::conditional<std::is_same<T, binary_token_vector>::value,binary_scanner,line_scanner>::type;
+
 #endif
@@ -1,22 +1,33 @@
 #ifndef token_vector_h
 #define token_vector_h
 
+#include <array>
 #include <iterator>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <type_traits>
+
+#include "simd_scan.h"
 
 /**
  * @brief Token container support class aimed at higher performance.
  *
  * Wraps up awkward iteration types for use in the parser.
  * Splits a delimited line into a vector of indices.
- * Each index holds a pointer to the place in the string where the token is found.
+ * Each index holds a view of the place in the line where the token is found.
  * It tries to minimise iteration passes of the line in one construction and does
- * not copy the original parts of the string.
+ * not copy or modify the original parts of the line, so the line can be read
+ * only memory such as a memory mapped file.
+ *
+ * The first inline_tokens views are held inside the token_vector, only longer
+ * lines (snapshots) spill over into a std::vector, so a normal order or trade
+ * line does no heap allocation.
  *
  * Exposes iterator class for use with token content
  */
-template <typename T, T delim=',', class A = std::allocator<T*>>
+template <typename T, T delim=',', class A = std::allocator<std::basic_string_view<T>>>
 struct token_vector
 {
     typedef A allocator_type;
@@ -28,8 +39,12 @@ struct token_vector
     typedef typename A::const_pointer const_pointer;
     typedef typename A::pointer pointer;
 
+    typedef std::basic_string_view<T> line_type;
     typedef std::vector<value_type> value_index_type;
-    typedef typename value_index_type::iterator value_index_type_iter;
+    typedef value_type* value_index_type_iter;
+
+    // Number of tokens held without allocating
+    static constexpr size_type inline_tokens=8;
 
      class iterator {
      public:
@@ -122,51 +137,89 @@ struct token_vector
 
      typedef std::reverse_iterator<iterator> reverse_iterator;
 
-     token_vector(std::string &line) {
-    	std::string::iterator end = line.end();
-    	std::string::iterator c = line.begin();
-    	token_index.push_back(&c[0]);
-    	for (; c != end; ++c)
-			if (*c == delim) {
-				 token_index.push_back(&c[1]);
-				 *c = '\0';
-			}
+     explicit token_vector(line_type line) {
+    	const T* c = line.data();
+    	const T* end = c + line.size();
+    	if constexpr (std::is_same<T, char>::value) {
+    		// Find the delimiters a vector at a time @see scan_tokens
+    		scan_tokens(c, end, delim, [this](const T* first, const T* last) {
+    			push_back(value_type(first, last - first));
+    		});
+    	}
+    	else {
+    		const T* token = c;
+    		for (; c != end; ++c)
+    			if (*c == delim) {
+    				push_back(value_type(token, c - token));
+    				token = c + 1;
+    			}
+    		push_back(value_type(token, end - token));
+    	}
     }
 
     iterator begin() noexcept {
-    	return iterator(token_index.begin());
+    	return iterator(data());
     }
 
     iterator end() noexcept {
-    	return iterator(token_index.end());
+    	return iterator(data() + count);
     }
 
     reverse_iterator rbegin() noexcept {
-    	return reverse_iterator(token_index.rbegin());
+    	return reverse_iterator(end());
     }
 
     reverse_iterator rend() noexcept {
-    	return reverse_iterator(token_index.rend());
+    	return reverse_iterator(begin());
     }
 
     reference front() noexcept {
-    	return token_index.front();
+    	return data()[0];
     }
 
     reference back() noexcept {
-    	return token_index.back();
+    	return data()[count - 1];
     }
 
     reference operator[](size_type i) {
-    	return token_index[i];
+    	return data()[i];
     }
 
     reference at(size_type i) {
-    	return token_index.at(i);
+    	if (i >= count) {
+    		throw std::out_of_range("Token index");
+    	}
+    	return data()[i];
+    }
+
+    size_type size() const noexcept {
+    	return count;
     }
 
 	private:
-    	value_index_type token_index;
+    	/**
+    	 * Tokens are inline until there are too many for it
+    	 */
+    	value_type* data() noexcept {
+    		return spill_index.empty() ? inline_index.data() : spill_index.data();
+    	}
+
+    	void push_back(const value_type& token) {
+    		if (count < inline_tokens) {
+    			inline_index[count] = token;
+    		}
+    		else {
+    			if (spill_index.empty()) {
+    				spill_index.assign(inline_index.begin(), inline_index.end());
+    			}
+    			spill_index.push_back(token);
+    		}
+    		++count;
+    	}
+
+    	std::array<value_type, inline_tokens> inline_index;
+    	value_index_type spill_index;
+    	size_type count = 0;
 };
 
 #endif